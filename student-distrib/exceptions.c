@@ -1,39 +1,7 @@
 #include "exceptions.h"
 #include "syscall.h"
-
-/* map exception to proper handler function */
-void exception_0() { exception_handler(0);}
-void exception_1() { exception_handler(1);}
-void exception_2() { exception_handler(2);}
-void exception_3() { exception_handler(3);}
-void exception_4() { exception_handler(4);}
-void exception_5() { exception_handler(5);}
-void exception_6() { exception_handler(6);}
-void exception_7() { exception_handler(7);}
-void exception_8() { exception_handler(8);}
-void exception_9() { exception_handler(9);}
-void exception_10() { exception_handler(10);}
-void exception_11() { exception_handler(11);}
-void exception_12() { exception_handler(12);}
-void exception_13() { exception_handler(13);}
-void exception_14() { exception_handler(14);}
-void exception_15() { exception_handler(15);}
-void exception_16() { exception_handler(16);}
-void exception_17() { exception_handler(17);}
-void exception_18() { exception_handler(18);}
-void exception_19() { exception_handler(19);}
-void exception_20() { exception_handler(20);}
-void exception_21() { exception_handler(21);}
-void exception_22() { exception_handler(22);}
-void exception_23() { exception_handler(23);}
-void exception_24() { exception_handler(24);}
-void exception_25() { exception_handler(25);}
-void exception_26() { exception_handler(26);}
-void exception_27() { exception_handler(27);}
-void exception_28() { exception_handler(28);}
-void exception_29() { exception_handler(29);}
-void exception_30() { exception_handler(30);}
-void exception_31() { exception_handler(31);}
+#include "terminal.h"
+#include "trace.h"
 
 void print_cr2()
 {
@@ -44,18 +12,57 @@ void print_cr2()
     printf("Suspected Address in CR2: %x\n", suspected_addr);
 }
 
+/*
+ * page_fault
+ *   DESCRIPTION: Program pages aren't loaded until they are touched, and shared
+ *      ones, from the file system or from fork, aren't copied until they
+ *      are written. A fault on one of them
+ *      fixes the page and the instruction runs again. Any other page fault is
+ *      a real exception.
+ *   INPUTS: address - the address that faulted, from CR2
+ *           regs - the saved registers, with the error code the processor pushed
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: a fault that can't be fixed goes to exception_handler
+ */
+void page_fault(uint32_t address, hw_context_t* regs)
+{
+    uint32_t error = regs->error_code;
+
+    TRACE(TRACE_PAGE_FAULT, address);
+
+    if(current_process[sched_terminal] >= 0)
+    {
+        if((error & PF_PRESENT) && (error & PF_WRITE) && copy_on_write(address) == 0)
+            return;
+        if((!(error & PF_PRESENT) || (error & PF_WRITE))
+                && load_image_page(address, error & PF_WRITE) == 0)
+            return;
+    }
+
+    exception_handler(regs);
+}
+
 /*
  * exception_handler
- *   DESCRIPTION: Prints proper exception to blue screen of death
- *   INPUTS: i - determines which exception was reached
+ *   DESCRIPTION: A program that caused an exception gets a signal, DIV_ZERO
+ *      for a divide error and SEGFAULT for anything else, it's handled on
+ *      the way back to the program. An exception in the kernel prints the
+ *      exception and halts the running process.
+ *   INPUTS: regs - the saved registers, irq_exc is the exception's vector
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: Halts OS by looping infinitely. Displays blue
- *   screen of death.
+ *   SIDE EFFECTS: doesn't return for an exception in the kernel
  */
-void exception_handler(int i) {
+void exception_handler(hw_context_t* regs) {
+    if((regs->cs & USER_RPL) && current_process[sched_terminal] >= 0)
+    {
+        signal_send(current_process[sched_terminal], (regs->irq_exc == 0) ? DIV_ZERO : SEGFAULT);
+        return;
+    }
+
     clear();
-    switch(i) {
+    switch(regs->irq_exc) {
         case 0:
             printf("Divide Error Exception\n");
             break;
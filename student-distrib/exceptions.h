@@ -2,10 +2,11 @@
 #define _EXCEPTIONS_H
 
 #include "lib.h"
+#include "signal.h"
 
 int exception_flag;
 
-/* ungeneralized exception handlers */
+/* ungeneralized exception handlers, the stubs in wrapper.S */
 extern void exception_0();
 extern void exception_1();
 extern void exception_2();
@@ -41,7 +42,17 @@ extern void exception_31();
 
 void print_cr2();
 
+#define USER_RPL 0x3 // privilege level bits of a saved cs
+
+/* page fault error code bits */
+#define PF_PRESENT 0x1 // the page was there, it's a protection fault
+#define PF_WRITE   0x2 // the access was a write
+
+/* loads program pages on first touch and copies shared ones on first write,
+ * anything else goes to exception_handler */
+void page_fault(uint32_t address, hw_context_t* regs);
+
 /* generalized exception handler */
-void exception_handler(int i);
+void exception_handler(hw_context_t* regs);
 
 #endif
@@ -9,6 +9,7 @@
 #include "terminal.h" // need driver, stdout
 #include "rtc.h"
 #include "filesystem.h"
+#include "pipe.h"
 
 /* JC
  * fops_table_init
@@ -45,6 +46,15 @@ void fops_table_init()
 	kybd_ops_table.read = keyboard_read;
 	kybd_ops_table.write = keyboard_write;
 	kybd_ops_table.close = keyboard_close;
+	// pipe jump tables, one per end
+	pipe_read_ops_table.open = pipe_open;
+	pipe_read_ops_table.read = pipe_read;
+	pipe_read_ops_table.write = pipe_no_write;
+	pipe_read_ops_table.close = pipe_close;
+	pipe_write_ops_table.open = pipe_open;
+	pipe_write_ops_table.read = pipe_no_read;
+	pipe_write_ops_table.write = pipe_write;
+	pipe_write_ops_table.close = pipe_close;
 }
 
 /* JC
@@ -67,6 +77,9 @@ void fd_table_init(fd_t* new_table)
 		(new_table[table_loop]).inode_ptr = -1;
 		(new_table[table_loop]).file_position = 0;
 		(new_table[table_loop]).flags = FD_OFF; // initialize all not in use.
+		(new_table[table_loop]).rtc_freq = 0;
+		(new_table[table_loop]).rtc_ticks = 0;
+		(new_table[table_loop]).pipe = NULL;
 	}
 
 	// open stdin
@@ -89,13 +102,32 @@ void close_all_fd()
 	// close all the fd
 	for(halt_cnt = 0; halt_cnt < MAX_OPEN_FILES; halt_cnt++)
 	{
-		(((process_array[current_process[curr_terminal]])->fd_table)[halt_cnt]).fd_jump = NULL;
-		(((process_array[current_process[curr_terminal]])->fd_table)[halt_cnt]).inode_ptr = -1;
-		(((process_array[current_process[curr_terminal]])->fd_table)[halt_cnt]).file_position = 0;
-		(((process_array[current_process[curr_terminal]])->fd_table)[halt_cnt]).flags = FD_OFF;
+		pipe_release(&(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]));
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).fd_jump = NULL;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).inode_ptr = -1;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).file_position = 0;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).flags = FD_OFF;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).rtc_freq = 0;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).rtc_ticks = 0;
+		(((process_array[current_process[sched_terminal]])->fd_table)[halt_cnt]).pipe = NULL;
 	}
 }
 
+/*
+ * fd_table_dup
+ *		DESCRIPTION:
+ *			Called on a copy of a process's descriptors. Files need nothing, the
+ *			pipe ends in it count as more descriptors of their pipes.
+ *		INPUT: table - the copy, MAX_OPEN_FILES entries
+ *		RETURN VALUE: none
+ */
+void fd_table_dup(fd_t* table)
+{
+	uint32_t i;
+	for(i = 0; i < MAX_OPEN_FILES; i++)
+		pipe_dup(&table[i]);
+}
+
 /* JC
  * get_fd_index
  * 	DESCRIPTION:
@@ -113,7 +145,7 @@ int32_t get_fd_index()
 	// should not consider index 0 and 1
 	for(table_loop = FIRST_VALID_INDEX; table_loop < MAX_OPEN_FILES; table_loop++)
 	{
-		if((((process_array[current_process[curr_terminal]])->fd_table)[table_loop]).flags == FD_OFF) // available index
+		if((((process_array[current_process[sched_terminal]])->fd_table)[table_loop]).flags == FD_OFF) // available index
 			return table_loop;
 	}
 
@@ -138,10 +170,13 @@ int32_t set_fd_info(int32_t index, fd_t file_info)
 		return -1;
 
 	// fill the table index with the given info
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).fd_jump = file_info.fd_jump;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).inode_ptr = file_info.inode_ptr;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).file_position = file_info.file_position;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).flags = file_info.flags;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).fd_jump = file_info.fd_jump;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).inode_ptr = file_info.inode_ptr;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).file_position = file_info.file_position;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).flags = file_info.flags;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).rtc_freq = file_info.rtc_freq;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).rtc_ticks = file_info.rtc_ticks;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).pipe = file_info.pipe;
 
 	return 0;
 }
@@ -161,7 +196,24 @@ int32_t get_inode_ptr(int32_t index)
 		return -1;
 
 	// get the ptr to the inode
-	return (((process_array[current_process[curr_terminal]])->fd_table)[index]).inode_ptr;
+	return (((process_array[current_process[sched_terminal]])->fd_table)[index]).inode_ptr;
+}
+
+/*
+ * get_fd
+ *		DESCRIPTION:
+ *			Gives drivers direct access to their descriptor, for driver specific fields
+ *		INPUT:
+ *			index - the fd table index
+ *		RETURN VALUE: pointer to the descriptor, NULL for an invalid index
+ *
+ */
+fd_t* get_fd(int32_t index)
+{
+	if(index < 0 || index >= MAX_OPEN_FILES)
+		return NULL;
+
+	return &(((process_array[current_process[sched_terminal]])->fd_table)[index]);
 }
 
 /* JC
@@ -179,10 +231,13 @@ void close_fd(int32_t index)
 		return;
 	
 	// close everything
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).fd_jump = NULL;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).inode_ptr = -1;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).file_position = 0;
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).flags = FD_OFF;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).fd_jump = NULL;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).inode_ptr = -1;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).file_position = 0;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).flags = FD_OFF;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).rtc_freq = 0;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).rtc_ticks = 0;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).pipe = NULL;
 }
 
 /*	JC
@@ -196,7 +251,7 @@ void close_fd(int32_t index)
  */
 uint32_t get_file_position(int32_t index)
 {
-	return (((process_array[current_process[curr_terminal]])->fd_table)[index]).file_position;
+	return (((process_array[current_process[sched_terminal]])->fd_table)[index]).file_position;
 }
 
 /* JC
@@ -214,7 +269,7 @@ void add_offset(int32_t index, uint32_t amt)
 	if(index < 0 || index >= MAX_OPEN_FILES)
 		return;
 	
-	(((process_array[current_process[curr_terminal]])->fd_table)[index]).file_position += amt;
+	(((process_array[current_process[sched_terminal]])->fd_table)[index]).file_position += amt;
 }
 
 /* JC
@@ -231,6 +286,6 @@ int32_t check_valid_fd(int32_t index)
 	if(index < 0 || index >= MAX_OPEN_FILES)
 		return 0;
 
-	return (((process_array[current_process[curr_terminal]])->fd_table)[index]).flags;
+	return (((process_array[current_process[sched_terminal]])->fd_table)[index]).flags;
 }
 
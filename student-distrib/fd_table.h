@@ -32,6 +32,9 @@ typedef struct file_descriptor_t {
 	uint32_t file_position; // current reading location in file, read system call should update this.
 	uint32_t flags; // among other things, marks file descriptor as in-use
 	// flags = 0, not in use, flags = 1, in use
+	uint32_t rtc_freq; // RTC only, virtual interrupt rate of this descriptor
+	uint32_t rtc_ticks; // RTC only, hardware tick count at its last virtual interrupt
+	struct pipe_t* pipe; // pipe ends only, the pipe shared with the other end
 } fd_t;
 
 /* Distinct operations */
@@ -40,15 +43,19 @@ fd_op_table_t filesys_ops_table;
 fd_op_table_t dir_ops_table;
 fd_op_table_t kybd_ops_table;
 fd_op_table_t term_ops_table;
+fd_op_table_t pipe_read_ops_table;
+fd_op_table_t pipe_write_ops_table;
 
 void fd_table_init(fd_t* new_table);
 void fops_table_init();
 void close_all_fd();
+void fd_table_dup(fd_t* table);
 
 /* Helpers */
 int32_t set_fd_info(int32_t index, fd_t file_info);
 int32_t get_fd_index();
 int32_t get_inode_ptr(int32_t index);
+fd_t* get_fd(int32_t index);
 
 uint32_t get_file_position(int32_t index);
 void add_offset(int32_t index, uint32_t amt);
@@ -12,6 +12,11 @@ static uint32_t num_data_blocks;
 
 /* holds the file_name size for all the dentries, maxes at 32 chars */
 static int32_t character_count[MAX_ENTRIES];
+/* open addressed hash of the file names, holds dentry indexes */
+static int32_t name_hash[NAME_HASH_SIZE];
+
+static uint32_t hash_name(const uint8_t* name, uint32_t len);
+static uint32_t given_name_length(const uint8_t* fname);
 
 /* JC
  * filesystem_init
@@ -42,6 +47,8 @@ void filesystem_init(boot_block_t* boot_addr)
 	data_blocks = (data_block_t*)(inodes+num_inodes);
 	// initiaize the file_name table
 	create_char_count();
+	// index the names so lookups don't scan every dentry
+	create_name_hash();
 
 	fops_table_init();
 	restore_flags(flags);
@@ -140,6 +147,9 @@ int32_t dir_open(const uint8_t* filename)
 	dir_fd_info.inode_ptr = -1;
 	dir_fd_info.file_position = 0; // start offset at 0
 	dir_fd_info.flags = FD_ON;	// in use
+	dir_fd_info.rtc_freq = 0; // not the rtc
+	dir_fd_info.rtc_ticks = 0;
+	dir_fd_info.pipe = NULL;
 	set_fd_info(fd_index, dir_fd_info);
 
 	return fd_index;
@@ -176,6 +186,48 @@ int32_t dir_read(int32_t fd, uint8_t* buf, int32_t nbytes)
 	return bytes_read;
 }
 
+/* JC
+ *	dir_getdents
+ *	DESCRIPTION:
+ *		Like dir_read, but fills the buffer with as many whole dirent_t records
+ *		as fit, starting at the fd's current entry. The offset moves past every
+ *		entry handed out.
+ *	INPUT:
+ *		fd - the directory's file descriptor
+ *		buf - the buffer to fill
+ *		nbytes - size of the buffer
+ *	OUTPUT:
+ *		none
+ *	RETURN VALUE:
+ *		bytes filled, always a multiple of sizeof(dirent_t)
+ *		0 - no more entries
+ *		-1 - buffer can't hold a single record
+ */
+int32_t dir_getdents(int32_t fd, uint8_t* buf, int32_t nbytes)
+{
+	uint32_t dent_index = get_file_position(fd); // get the current file index
+	dirent_t* records = (dirent_t*)buf;
+	uint32_t max_records;
+	uint32_t filled = 0;
+
+	if(nbytes < (int32_t)sizeof(dirent_t))
+		return -1;
+	max_records = nbytes / sizeof(dirent_t);
+
+	for(; dent_index < num_entries && filled < max_records; dent_index++, filled++)
+	{
+		memcpy(records[filled].file_name, (entries[dent_index]).file_name, MAX_NAME_CHARACTERS);
+		records[filled].file_type = (entries[dent_index]).file_type;
+		records[filled].inode_idx = (entries[dent_index]).inode_idx;
+		// only regular files have a meaningful inode
+		records[filled].file_size = (records[filled].file_type == REGULAR_FILE && records[filled].inode_idx < num_inodes)
+				? (inodes[records[filled].inode_idx]).file_size : 0;
+	}
+
+	add_offset(fd, filled); // next call starts after these
+	return filled * sizeof(dirent_t);
+}
+
 /* JC
  *	dir_write
  *	DESCRIPTION:
@@ -243,6 +295,9 @@ int32_t file_open(const uint8_t* filename)
 	file_fd_info.inode_ptr = my_dentry.inode_idx;
 	file_fd_info.file_position = 0; // start offset at 0
 	file_fd_info.flags = FD_ON;	// in use
+	file_fd_info.rtc_freq = 0; // not the rtc
+	file_fd_info.rtc_ticks = 0;
+	file_fd_info.pipe = NULL;
 	set_fd_info(fd_index, file_fd_info);
 
 	return fd_index;
@@ -335,13 +390,62 @@ void create_char_count()
 	}
 }
 
+/* JC
+ * create_name_hash
+ * 	DESCRIPTION:
+ *			Puts every named dentry into the name hash. Collisions go to the next
+ *			free slot, earlier dentries are inserted first so a lookup finds the
+ *			same dentry the old scan did if a name shows up twice.
+ *		INPUT: none
+ *		OUTPUT: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: fills in name_hash
+ *
+ */
+void create_name_hash()
+{
+	uint32_t dentry_loop;
+	uint32_t slot;
+
+	for(slot = 0; slot < NAME_HASH_SIZE; slot++)
+		name_hash[slot] = NO_ENTRY;
+
+	for(dentry_loop = 0; dentry_loop < MAX_ENTRIES; dentry_loop++)
+	{
+		if(character_count[dentry_loop] == 0)
+			continue; // unused dentry, can never match
+		slot = hash_name((uint8_t*)(entries[dentry_loop]).file_name, character_count[dentry_loop]);
+		while(name_hash[slot] != NO_ENTRY)
+			slot = (slot + 1) & NAME_HASH_MASK; // linear probe
+		name_hash[slot] = dentry_loop;
+	}
+}
+
+/* JC
+ * hash_name - helper
+ * 	DESCRIPTION: FNV-1a hash of the first len chars of the name.
+ *		INPUT: name - the name, len - how many chars of it to use
+ *		RETURN VALUE: a slot in name_hash
+ */
+static uint32_t hash_name(const uint8_t* name, uint32_t len)
+{
+	uint32_t hash = FNV_OFFSET;
+	uint32_t i;
+	for(i = 0; i < len; i++)
+	{
+		hash ^= name[i];
+		hash *= FNV_PRIME;
+	}
+	return hash & NAME_HASH_MASK;
+}
+
 /* JC
  * read_dentry_by_name
  * 	DESCRIPTION:
- *			Use the pointer to the start of dentry like an array to access
- *			each entry's file name. Find the matching file name if it exists.
- *			return with the status of the find. Fills in the dentry structure
- *			pointer if a match is found.
+ *			Hashes the name and looks it up in the name hash, only dentries
+ *			in the name's probe sequence get compared. Find the matching file name
+ *			if it exists. return with the status of the find. Fills in the dentry
+ *			structure pointer if a match is found.
  *		INPUT:
  *			fname - the file name, string, that we need to find
  *			dentry - a pointer to the dentry structure that should be filled
@@ -353,40 +457,83 @@ void create_char_count()
  */
 int32_t read_dentry_by_name(const uint8_t *fname, dentry_t *dentry)
 {
-	int32_t entry_name_len; // holds how long the dentry's filename is
+	int32_t dentry_idx;
+	uint32_t slot;
+	int32_t given_name_len = given_name_length(fname);
+
+	if(given_name_len == 0)
+		return -1; // empty string
+
+	// follow the probe sequence until the name or an empty slot shows up
+	for(slot = hash_name(fname, given_name_len); (dentry_idx = name_hash[slot]) != NO_ENTRY; slot = (slot + 1) & NAME_HASH_MASK)
+	{
+		// no point in checking if not the same length
+		if(given_name_len == character_count[dentry_idx]
+				&& strncmp((int8_t*)fname, (entries[dentry_idx]).file_name, given_name_len) == 0)
+		{
+			strncpy(dentry->file_name, (entries[dentry_idx]).file_name, given_name_len); // (dest, src)
+			dentry->file_type = (entries[dentry_idx]).file_type;
+			dentry->inode_idx = (entries[dentry_idx]).inode_idx;
+			return 0; // found the entry
+		}
+	}
+	return -1;
+}
+
+/* JC
+ * scan_dentry_by_name
+ * 	DESCRIPTION:
+ *			The lookup read_dentry_by_name used before the name hash, goes through
+ *			every dentry. Kept to compare against in the tests.
+ *		INPUT:
+ *			fname - the file name, string, that we need to find
+ *			dentry - a pointer to the dentry structure that should be filled
+ *		OUTPUT: none
+ *		RETURN VALUE: -1 - Failure (non-existent file)
+ *						   0 - Success (found the file)
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t scan_dentry_by_name(const uint8_t *fname, dentry_t *dentry)
+{
 	int32_t dentry_loop;
-	int32_t given_name_len = 0;
-	// Count how many characters are in the current dentry's name
-	while((fname[given_name_len] != ' ') && (fname[given_name_len] != '\0')
-			&& (given_name_len < MAX_NAME_CHARACTERS))
-		given_name_len++;
+	int32_t given_name_len = given_name_length(fname);
 
 	if(given_name_len == 0)
 		return -1; // empty string
 
-	if(given_name_len > MAX_NAME_CHARACTERS)
-		given_name_len = MAX_NAME_CHARACTERS; // pretend as if it's the same size.
 	// go through all the dentries
 	for(dentry_loop = 0; dentry_loop < MAX_ENTRIES; dentry_loop++)
 	{
-		// get the size of the entry's name from the count table
-		entry_name_len = character_count[dentry_loop];
 		// no point in checking if not the same length
-		if(given_name_len == entry_name_len)
+		if(given_name_len == character_count[dentry_loop]
+				&& strncmp((int8_t*)fname, (entries[dentry_loop]).file_name, given_name_len) == 0)
 		{
-			// if the strings are the same, copy over data
-			if(strncmp((int8_t*)fname, (entries[dentry_loop]).file_name, entry_name_len) == 0)
-			{
-				strncpy(dentry->file_name, (entries[dentry_loop]).file_name, entry_name_len); // (dest, src)
-				dentry->file_type = (entries[dentry_loop]).file_type;
-				dentry->inode_idx = (entries[dentry_loop]).inode_idx;
-				return 0; // found the entry
-			}
+			strncpy(dentry->file_name, (entries[dentry_loop]).file_name, given_name_len); // (dest, src)
+			dentry->file_type = (entries[dentry_loop]).file_type;
+			dentry->inode_idx = (entries[dentry_loop]).inode_idx;
+			return 0; // found the entry
 		}
 	}
 	return -1;
 }
 
+/* JC
+ * given_name_length - helper
+ * 	DESCRIPTION:
+ *			Counts the characters of a name passed to a lookup. The name ends at
+ *			a space (arguments follow) or at the null, maxing at 32 chars.
+ *		INPUT: fname - the name
+ *		RETURN VALUE: the length of the name
+ */
+static uint32_t given_name_length(const uint8_t* fname)
+{
+	uint32_t len = 0;
+	while((fname[len] != ' ') && (fname[len] != '\0') && (len < MAX_NAME_CHARACTERS))
+		len++;
+	return len;
+}
+
 /* JC
  * read_dentry_by_index
  * 	DESCRIPTION:
@@ -428,12 +575,37 @@ int8_t* get_entry_name(uint32_t index)
 	return (entries[index]).file_name;
 }
 
+/* JC
+ * get_block_addr
+ * 	DESCRIPTION:
+ *			Finds the data block that holds part of a file. The image is loaded
+ *			page aligned, so every block is a whole 4kb page that can be mapped.
+ *		INPUT:
+ *			inode - the inode index
+ *			block - which block of the file, 0 is the first 4096 bytes
+ *		RETURN VALUE: address of the block, -1 if the file doesn't have that block
+ *		SIDE EFFECTS: none
+ */
+int32_t get_block_addr(uint32_t inode, uint32_t block)
+{
+	uint32_t data_idx;
+	if(inode >= num_inodes || block >= MAX_INODE_DATA_BLOCKS
+			|| block*MAX_CHARS_IN_DATA >= (inodes[inode]).file_size)
+		return -1;
+
+	data_idx = ((inodes[inode]).datablock_idx)[block];
+	if(data_idx >= num_data_blocks)
+		return -1; // invalid data block index
+	return (int32_t)(&(data_blocks[data_idx]));
+}
+
 /* JC
  * read_data
  * 	DESCRIPTION:
  *			Reads up to 'length' number of bytes. starting from position offset.
  *			in the file with inode number inode and returning the number of bytes
- *			read and placed in the buffer.
+ *			read and placed in the buffer. Data blocks with consecutive indexes
+ *			are copied together with a single memcpy.
  *		INPUT:
  *			inode - the inode index, that we want
  *			offset - offset from the start of file
@@ -455,56 +627,58 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
 {
 	// edge case checking
 	uint32_t this_file_size;
-	// finding where to start
-	uint32_t start_block, start_offset;
 	// finding where to end
-	uint32_t end_search, end_block, end_offset;
+	uint32_t end_search;
 	// doing the task
 	uint32_t block_loop;
 	uint32_t chars_read;
 	uint32_t curr_byte; // keep track of current byte
-	uint32_t curr_data_block; // current data block
-	uint32_t end_of_block_byte;
+	uint32_t curr_data_block; // first data block of the current run
+	uint32_t run_blocks; // how many blocks in a row are next to each other
+	uint32_t run_end; // file position where the run stops
+	int32_t* block_idx;
 	if(inode >= num_inodes)
 		return -1; // inode number too big
 	this_file_size = (inodes[inode]).file_size; // reduce syntax
+	block_idx = (inodes[inode]).datablock_idx;
 	// offset is greater than file size or no need to read
 	if((offset >= this_file_size) || (length == 0))
 		return 0;
-	/* Find the start location (data block, offset in data block) */
-	start_block = offset/MAX_CHARS_IN_DATA;
-	start_offset = offset%MAX_CHARS_IN_DATA; // offset in start block
-	/* Find the end location (data block, offset in data block) */
+	/* Find the end location */
 	end_search = offset+length;
 	// should not go past the total number of chars
-	if(end_search > this_file_size)
+	if(end_search > this_file_size || end_search < offset)
 		end_search = this_file_size;
-	// last block we need
-	end_block = end_search/MAX_CHARS_IN_DATA;	// 4096/4096 = 1
-	end_offset = end_search%MAX_CHARS_IN_DATA; // offset in end block
 	chars_read = 0;
-	curr_byte = start_offset;
-	end_of_block_byte = MAX_CHARS_IN_DATA;
-	/* Start putting data into the buffer */
-	for(block_loop = start_block; block_loop <= end_block; block_loop++)
+	/* Start putting data into the buffer, one run of adjacent blocks at a time */
+	while(offset < end_search)
 	{
-		curr_data_block = ((inodes[inode]).datablock_idx)[block_loop]; // get the index of current block from inode
-		if(curr_data_block > num_data_blocks)
+		block_loop = offset/MAX_CHARS_IN_DATA;
+		curr_byte = offset%MAX_CHARS_IN_DATA; // offset in the first block
+		curr_data_block = block_idx[block_loop]; // get the index of current block from inode
+		if(curr_data_block >= num_data_blocks)
 		{
 			if(chars_read == 0)
 				return -1; // invalid data block index, haven't read anything
 			else
 				return chars_read; // found invalid block, but read some stuff
 		}
-		if(block_loop == end_block)
-			end_of_block_byte = end_offset; // last block, change how far to parse
-		while(curr_byte < end_of_block_byte)
+		// the blocks sit in one array, so blocks with consecutive indexes are one copy
+		run_blocks = 1;
+		run_end = (block_loop+1)*MAX_CHARS_IN_DATA;
+		while(run_end < end_search
+				&& block_idx[block_loop+run_blocks] == curr_data_block+run_blocks
+				&& curr_data_block+run_blocks < num_data_blocks)
 		{
-			buf[chars_read] = ((data_blocks[curr_data_block]).data)[curr_byte]; // get char
-			chars_read++; // next byte to fill
-			curr_byte++; // next byte in filesys
+			run_blocks++;
+			run_end += MAX_CHARS_IN_DATA;
 		}
-		curr_byte = 0; // reset to the beginning
+		if(run_end > end_search)
+			run_end = end_search; // last block, change how far to copy
+
+		memcpy(buf+chars_read, &(((data_blocks[curr_data_block]).data)[curr_byte]), run_end-offset);
+		chars_read += run_end-offset;
+		offset = run_end;
 	}
 	return chars_read;
 }
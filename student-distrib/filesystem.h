@@ -29,6 +29,16 @@
 
 #define NUM_SPACES 34 // used in formating file info's print
 
+/* File Type Macros */
+#define REGULAR_FILE 2 // file_type of a file with data blocks
+
+/* Name Hash Macros */
+#define NAME_HASH_SIZE 128 // power of two, at least twice MAX_ENTRIES so probes stay short
+#define NAME_HASH_MASK (NAME_HASH_SIZE-1)
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+#define NO_ENTRY -1
+
 /* The structures used to organize the filesys_img data */
 typedef struct dentry_t {
 	int8_t file_name[MAX_NAME_CHARACTERS]; // 32 chars in the file name
@@ -50,6 +60,14 @@ typedef struct inode_t {
 	int32_t datablock_idx[MAX_INODE_DATA_BLOCKS]; // holds indexs for each data block
 } inode_t; /* represents where the file's data is all located */
 
+/* one record of getdents, filled in back to back */
+typedef struct dirent_t {
+	int8_t file_name[MAX_NAME_CHARACTERS]; // not null terminated at 32 chars
+	uint32_t file_type;
+	uint32_t inode_idx;
+	uint32_t file_size; // 0 for anything but regular files
+} dirent_t;
+
 /* data blocks should be all chars */
 typedef struct data_block_t {
 	int8_t data[MAX_CHARS_IN_DATA];
@@ -64,6 +82,7 @@ int8_t* get_entry_name(uint32_t index);
 /* Initializes the file system with relevant information */
 void filesystem_init(boot_block_t* boot_addr);
 void create_char_count(); // helper
+void create_name_hash(); // helper, needs the char count
 
 /* The three routines provided by the file system module return -1 on failure
  * more documentation in MP3.
@@ -71,12 +90,15 @@ void create_char_count(); // helper
 int32_t read_dentry_by_name(const uint8_t *fname, dentry_t *dentry);
 int32_t read_dentry_by_index(uint32_t index, dentry_t *dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t get_block_addr(uint32_t inode, uint32_t block); // where a block of a file sits in memory
+int32_t scan_dentry_by_name(const uint8_t *fname, dentry_t *dentry); // old linear lookup, for testing
 
 /************Dir Driver Stuff**************/
 int32_t dir_open(const uint8_t* filename);
 int32_t dir_read(int32_t fd, uint8_t* buf, int32_t nbytes);
 int32_t dir_write(int32_t fd, const void* blank1, int32_t blank2);
 int32_t dir_close(int32_t fd);
+int32_t dir_getdents(int32_t fd, uint8_t* buf, int32_t nbytes);
 /***********File Driver Stuff**************/
 int32_t file_open(const uint8_t* filename);
 int32_t file_read(int32_t fd, uint8_t* buf, int32_t nbytes);
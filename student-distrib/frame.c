@@ -0,0 +1,277 @@
+/*
+ * frame.c - Physical page frame allocator.
+ *
+ *		Every 4kb frame of physical memory has a bit, set when the frame is in
+ *		use. Only RAM the boot loader reports as usable and that lies past the
+ *		kernel's 8MB is ever free. The search starts at the first word that may
+ *		have a free frame, so allocating is usually a single word test.
+ */
+
+#include "frame.h"
+
+#define FULL_WORD 0xFFFFFFFF
+
+static uint32_t frame_bitmap[FRAME_WORDS]; // 1 - in use, 0 - free
+static uint32_t frames_left;
+static uint32_t first_word; // no free frame before this word
+static uint8_t frame_refs[NUM_FRAMES]; // page tables mapping each user frame
+
+/*
+ * set_frames - helper
+ *		DESCRIPTION: Marks the frames in [start, end) used or free.
+ *		INPUT: start, end - physical addresses, 4kb aligned
+ *				 used - 1 to take the frames, 0 to free them
+ *		RETURN VALUE: none
+ */
+static void set_frames(uint32_t start, uint32_t end, uint32_t used)
+{
+	uint32_t frame;
+
+	for(frame = start >> FRAME_SHIFT; frame < (end >> FRAME_SHIFT); frame++)
+	{
+		uint32_t bit = 1 << (frame % FRAMES_PER_WORD);
+		uint32_t* word = &frame_bitmap[frame / FRAMES_PER_WORD];
+
+		if(used && !(*word & bit))
+		{
+			*word |= bit;
+			frames_left--;
+		}
+		else if(!used && (*word & bit))
+		{
+			*word &= ~bit;
+			frames_left++;
+		}
+	}
+}
+
+/*
+ * free_region - helper
+ *		DESCRIPTION:
+ *			Frees the whole frames of a usable region of RAM, leaving out the
+ *			kernel's memory and anything past MAX_PHYS_MEM.
+ *		INPUT: start, end - physical addresses of the region
+ *		RETURN VALUE: none
+ */
+static void free_region(uint32_t start, uint32_t end)
+{
+	if(start < FIRST_FRAME)
+		start = FIRST_FRAME;
+	if(end > MAX_PHYS_MEM)
+		end = MAX_PHYS_MEM;
+
+	start = (start + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1); // partial frames stay used
+	end &= ~(FRAME_SIZE - 1);
+	if(start < end)
+		set_frames(start, end, 0);
+}
+
+/*
+ * frame_init
+ *		DESCRIPTION:
+ *			Starts with every frame in use and frees the usable RAM from the boot
+ *			loader's memory map. Falls back to mem_upper without a memory map.
+ *			Modules stay in use wherever they were loaded.
+ *		INPUT: mbi - the multiboot information, paging must still be off
+ *		RETURN VALUE: none
+ */
+void frame_init(multiboot_info_t* mbi)
+{
+	memset_dword(frame_bitmap, FULL_WORD, FRAME_WORDS);
+	frames_left = 0;
+	first_word = 0;
+
+	if(mbi->flags & (1 << MMAP_FLAG))
+	{
+		memory_map_t* mmap;
+		for(mmap = (memory_map_t*)mbi->mmap_addr;
+				(uint32_t)mmap < mbi->mmap_addr + mbi->mmap_length;
+				mmap = (memory_map_t*)((uint32_t)mmap + mmap->size + sizeof(mmap->size)))
+		{
+			uint32_t end = mmap->base_addr_low + mmap->length_low;
+
+			if(mmap->type != MMAP_AVAILABLE || mmap->base_addr_high != 0)
+				continue;
+			if(mmap->length_high != 0 || end < mmap->base_addr_low)
+				end = MAX_PHYS_MEM; // runs past 4GB
+			free_region(mmap->base_addr_low, end);
+		}
+	}
+	else if(mbi->flags & (1 << MEM_FLAG))
+	{
+		free_region(MEM_UPPER_START, MEM_UPPER_START + mbi->mem_upper * 1024);
+	}
+
+	if(mbi->flags & (1 << MODS_FLAG))
+	{
+		uint32_t i;
+		module_t* mod = (module_t*)mbi->mods_addr;
+		for(i = 0; i < mbi->mods_count; i++, mod++)
+		{
+			uint32_t end = (mod->mod_end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+			if(mod->mod_start < MAX_PHYS_MEM)
+				set_frames(mod->mod_start & ~(FRAME_SIZE - 1),
+						end > MAX_PHYS_MEM ? MAX_PHYS_MEM : end, 1);
+		}
+	}
+}
+
+/*
+ * take_frames - helper
+ *		DESCRIPTION:
+ *			Takes the first count free frames in a row that start at a multiple
+ *			of count, searching the bitmap up to word words.
+ *		INPUT: count - frames in a row, a power of 2 up to FRAMES_PER_WORD
+ *				 words - the search stops before this word
+ *		RETURN VALUE: physical address of the first frame, -1 if there's no room
+ *		SIDE EFFECTS: the frames aren't cleared
+ */
+static int32_t take_frames(uint32_t count, uint32_t words)
+{
+	uint32_t flags;
+	uint32_t i, bit;
+	uint32_t mask = (count >= FRAMES_PER_WORD) ? FULL_WORD : (1 << count) - 1;
+	cli_and_save(flags);
+
+	for(i = first_word; i < words; i++)
+	{
+		if(frame_bitmap[i] == FULL_WORD)
+			continue;
+
+		for(bit = 0; bit < FRAMES_PER_WORD; bit += count)
+		{
+			if(frame_bitmap[i] & (mask << bit))
+				continue;
+
+			frame_bitmap[i] |= mask << bit;
+			frames_left -= count;
+			if(count == 1)
+				first_word = i; // every word before it is full
+			restore_flags(flags);
+			return (i * FRAMES_PER_WORD + bit) << FRAME_SHIFT;
+		}
+	}
+
+	restore_flags(flags);
+	return -1;
+}
+
+/*
+ * alloc_frame
+ *		DESCRIPTION: Takes the lowest free frame, for user pages.
+ *		INPUT: none
+ *		RETURN VALUE: physical address of the frame, -1 if there's none left
+ *		SIDE EFFECTS: the frame isn't cleared
+ */
+int32_t alloc_frame()
+{
+	int32_t phys = take_frames(1, FRAME_WORDS);
+	if(phys != -1)
+		frame_refs[phys >> FRAME_SHIFT] = 1;
+	return phys;
+}
+
+/*
+ * free_frame
+ *		DESCRIPTION: Drops a reference to a frame from alloc_frame, the last one gives it back.
+ *		INPUT: phys - physical address of the frame
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: frames that weren't allocated are ignored
+ */
+void free_frame(uint32_t phys)
+{
+	uint32_t flags;
+	cli_and_save(flags);
+
+	if(phys < MAX_PHYS_MEM && frame_refs[phys >> FRAME_SHIFT] > 1)
+		frame_refs[phys >> FRAME_SHIFT]--;
+	else
+	{
+		if(phys < MAX_PHYS_MEM)
+			frame_refs[phys >> FRAME_SHIFT] = 0;
+		free_kernel_frames(phys, 1);
+	}
+
+	restore_flags(flags);
+}
+
+/*
+ * share_frame
+ *		DESCRIPTION: Adds a reference to a frame from alloc_frame, one more page table maps it.
+ *		INPUT: phys - physical address of the frame
+ *		RETURN VALUE: none
+ */
+void share_frame(uint32_t phys)
+{
+	uint32_t flags;
+	cli_and_save(flags);
+
+	if(phys < MAX_PHYS_MEM)
+		frame_refs[phys >> FRAME_SHIFT]++;
+
+	restore_flags(flags);
+}
+
+/*
+ * frame_references
+ *		DESCRIPTION: How many page tables map a frame from alloc_frame.
+ *		INPUT: phys - physical address of the frame
+ *		RETURN VALUE: the number of references
+ */
+uint32_t frame_references(uint32_t phys)
+{
+	return (phys < MAX_PHYS_MEM) ? frame_refs[phys >> FRAME_SHIFT] : 0;
+}
+
+/*
+ * alloc_kernel_frames
+ *		DESCRIPTION:
+ *			Takes count frames in a row below DIRECT_MAP_END, where the kernel
+ *			can use them at their physical address. The block is aligned to its
+ *			size, an 8KB kernel stack starts on an 8KB boundary.
+ *		INPUT: count - number of frames, a power of 2 up to FRAMES_PER_WORD
+ *		RETURN VALUE: physical (and kernel virtual) address, -1 if there's no room
+ *		SIDE EFFECTS: the frames aren't cleared
+ */
+int32_t alloc_kernel_frames(uint32_t count)
+{
+	if(count == 0 || count > FRAMES_PER_WORD || (count & (count - 1)))
+		return -1;
+	return take_frames(count, DIRECT_WORDS);
+}
+
+/*
+ * free_kernel_frames
+ *		DESCRIPTION: Gives frames from alloc_kernel_frames back.
+ *		INPUT: phys - address of the first frame
+ *				 count - how many frames
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: frames that weren't allocated are ignored
+ */
+void free_kernel_frames(uint32_t phys, uint32_t count)
+{
+	uint32_t flags;
+	uint32_t word = (phys >> FRAME_SHIFT) / FRAMES_PER_WORD;
+	cli_and_save(flags);
+
+	if(phys >= FIRST_FRAME && phys < MAX_PHYS_MEM && !(phys & (FRAME_SIZE - 1))
+			&& count <= (MAX_PHYS_MEM - phys) >> FRAME_SHIFT)
+	{
+		set_frames(phys, phys + count * FRAME_SIZE, 0);
+		if(word < first_word)
+			first_word = word;
+	}
+
+	restore_flags(flags);
+}
+
+/*
+ * free_frame_count
+ *		DESCRIPTION: Number of frames alloc_frame can still hand out.
+ *		INPUT: none
+ *		RETURN VALUE: free frames
+ */
+uint32_t free_frame_count()
+{
+	return frames_left;
+}
@@ -0,0 +1,45 @@
+/*
+ * frame.h - Physical page frame allocator.
+ *
+ */
+
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "lib.h"
+#include "multiboot.h"
+
+#define FRAME_SIZE      0x00001000  // 4kb
+#define FRAME_SHIFT     12
+#define MAX_PHYS_MEM    0x40000000  // 1GB, frames past this are never handed out
+#define NUM_FRAMES      (MAX_PHYS_MEM >> FRAME_SHIFT)
+#define FRAMES_PER_WORD 32
+#define FRAME_WORDS     (NUM_FRAMES / FRAMES_PER_WORD)
+#define FIRST_FRAME     0x00800000  // everything below belongs to the kernel
+#define DIRECT_MAP_END  0x08000000  // the kernel reaches frames below 128MB at the same address
+#define DIRECT_WORDS    ((DIRECT_MAP_END >> FRAME_SHIFT) / FRAMES_PER_WORD)
+#define MEM_UPPER_START 0x00100000  // mem_upper counts from 1MB
+#define MMAP_AVAILABLE  1           // memory map type of usable RAM
+#define MMAP_FLAG       6           // multiboot flag bit, mmap_* are valid
+#define MEM_FLAG        0           // multiboot flag bit, mem_* are valid
+#define MODS_FLAG       3           // multiboot flag bit, mods_* are valid
+
+/* builds the free list from the boot loader's memory map */
+void frame_init(multiboot_info_t* mbi);
+
+/* a free 4kb frame, -1 when memory is used up */
+int32_t alloc_frame();
+void free_frame(uint32_t phys);
+
+/* count frames in a row for the kernel, aligned to count, count is a power of 2 up to 32 */
+int32_t alloc_kernel_frames(uint32_t count);
+void free_kernel_frames(uint32_t phys, uint32_t count);
+
+/* user frames shared by several processes, freed with the last reference */
+void share_frame(uint32_t phys);
+uint32_t frame_references(uint32_t phys);
+
+/* how many frames are left */
+uint32_t free_frame_count();
+
+#endif /* _FRAME_H */
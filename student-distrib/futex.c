@@ -0,0 +1,97 @@
+/*
+ * futex.c - User space waits on memory words.
+ *
+ *		A lock or condition in user memory only needs the kernel when a process
+ *		has to wait for it. The process asks to sleep as long as the word still
+ *		holds what it saw, the process that changes the word asks for sleepers
+ *		to be woken. Words are told apart by physical address, so processes
+ *		that share a page through shmmap find each other whatever address they
+ *		map it at. Checking the word and going to sleep happen with interrupts
+ *		off, a wake up can't slip in between.
+ */
+
+#include "futex.h"
+
+static futex_waiter_t* buckets[FUTEX_BUCKETS];
+
+/*
+ * bucket - helper
+ *		DESCRIPTION: The list waiters on a word go in.
+ *		INPUT: key - physical address of the word
+ *		RETURN VALUE: head of the list
+ */
+static futex_waiter_t** bucket(uint32_t key)
+{
+	return &buckets[(key / sizeof(int32_t)) % FUTEX_BUCKETS];
+}
+
+/*
+ * futex_wait_on
+ *		DESCRIPTION:
+ *			Puts the running process to sleep until futex_wake_up is called on
+ *			key, unless the word has changed from expected already.
+ *		INPUT: key - physical address of the word
+ *				 word - the word, mapped in the running process
+ *				 expected - the value the caller saw
+ *		RETURN VALUE: 0 - woken up, -1 - the word didn't hold expected
+ */
+int32_t futex_wait_on(uint32_t key, volatile int32_t* word, int32_t expected)
+{
+	uint32_t flags;
+	futex_waiter_t me;
+	futex_waiter_t** link;
+	cli_and_save(flags);
+
+	if(*word != expected)
+	{
+		restore_flags(flags);
+		return -1;
+	}
+
+	me.key = key;
+	me.woken = 0;
+	wait_queue_init(&me.queue);
+	me.next = NULL;
+	for(link = bucket(key); *link != NULL; link = &(*link)->next)
+		; // at the end, whoever waited first is woken first
+	*link = &me;
+
+	while(!me.woken)
+		sleep_on(&me.queue); // futex_wake_up took us off the list
+
+	restore_flags(flags);
+	return 0;
+}
+
+/*
+ * futex_wake_up
+ *		DESCRIPTION: Wakes the first n processes waiting on key.
+ *		INPUT: key - physical address of the word
+ *				 n - how many to wake at most
+ *		RETURN VALUE: the number woken
+ *		SIDE EFFECTS: safe to call from interrupt handlers
+ */
+int32_t futex_wake_up(uint32_t key, int32_t n)
+{
+	uint32_t flags;
+	int32_t woken = 0;
+	futex_waiter_t** link = bucket(key);
+	futex_waiter_t* waiter;
+	cli_and_save(flags);
+
+	while(woken < n && (waiter = *link) != NULL)
+	{
+		if(waiter->key != key)
+		{
+			link = &waiter->next;
+			continue;
+		}
+		*link = waiter->next;
+		waiter->woken = 1;
+		wake_up(&waiter->queue);
+		woken++;
+	}
+
+	restore_flags(flags);
+	return woken;
+}
@@ -0,0 +1,28 @@
+/*
+ * futex.h - Declarations for user space waits on memory words.
+ *
+ */
+
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include "lib.h"
+#include "sched.h"
+
+#define FUTEX_BUCKETS 16 // waiters are hashed by the word's physical address
+
+/* a process waiting on a word, lives on its kernel stack */
+typedef struct futex_waiter_t {
+	uint32_t key;		// physical address of the word
+	uint32_t woken;	// set by futex_wake_up, sleeping again would miss it
+	wait_queue_t queue;	// only this waiter sleeps on it
+	struct futex_waiter_t* next;
+} futex_waiter_t;
+
+/* sleeps if the word still holds expected, returns once woken */
+int32_t futex_wait_on(uint32_t key, volatile int32_t* word, int32_t expected);
+
+/* wakes up to n processes waiting on key, returns how many */
+int32_t futex_wake_up(uint32_t key, int32_t n);
+
+#endif /* _FUTEX_H */
@@ -45,7 +45,7 @@ void idt_init() {
     SET_IDT_ENTRY(idt[11], exception_11);
     SET_IDT_ENTRY(idt[12], exception_12);
     SET_IDT_ENTRY(idt[13], exception_13);
-    SET_IDT_ENTRY(idt[14], exception_14);
+    SET_IDT_ENTRY(idt[14], page_fault_wrapper); // program pages are loaded on first touch
     SET_IDT_ENTRY(idt[15], exception_15);
     SET_IDT_ENTRY(idt[16], exception_16);
     SET_IDT_ENTRY(idt[17], exception_17);
@@ -87,6 +87,49 @@ void idt_init() {
     idt[SYSCALL_VECTOR_NUM].dpl = 3;
     SET_IDT_ENTRY(idt[SYSCALL_VECTOR_NUM], syscall_handler_wrapper);
 
+    /* The same system calls through SYSENTER */
+    sysenter_init();
+
     // mapped keyboard in keyboard init
     // mapped RTC in RTC init
 }
+
+/*
+ * wrmsr - helper
+ *   DESCRIPTION: Writes a model specific register
+ *   INPUTS: msr - which register, value - the low 32 bits, the high ones are 0
+ */
+static void wrmsr(uint32_t msr, uint32_t value)
+{
+    asm volatile("wrmsr"
+            :
+            : "c"(msr), "a"(value), "d"(0)
+            : "memory");
+}
+
+/*
+ * sysenter_init
+ *   DESCRIPTION: Points SYSENTER at sysenter_handler. SYSEXIT takes the user
+ *      segments from the GDT entries after KERNEL_CS, which is where USER_CS
+ *      and USER_DS already are. The handler loads the kernel stack from the
+ *      TSS itself, so the stack register never has to change.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: writes the SYSENTER MSRs
+ */
+void sysenter_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    /* does the processor have SYSENTER at all */
+    asm volatile("cpuid"
+            : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+            : "a"(CPUID_FEATURES));
+    if(!(edx & CPUID_SEP))
+        return; // only int 0x80 then
+
+    wrmsr(IA32_SYSENTER_CS, KERNEL_CS);
+    wrmsr(IA32_SYSENTER_ESP, tss.esp0); // replaced right away by the handler
+    wrmsr(IA32_SYSENTER_EIP, (uint32_t)sysenter_handler);
+}
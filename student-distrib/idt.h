@@ -18,7 +18,16 @@
 #define PIT_VECTOR_NUM 	32		// 0x20
 #define SYSCALL_VECTOR_NUM 128 // 0x80
 
+/* SYSENTER model specific registers */
+#define IA32_SYSENTER_CS	0x174
+#define IA32_SYSENTER_ESP	0x175
+#define IA32_SYSENTER_EIP	0x176
+#define CPUID_SEP	0x00000800	// edx bit 11, SYSENTER/SYSEXIT are there
+
 /* Initialize the idt, including mapping all 256 entries */
 void idt_init(void);
 
+/* Set up the SYSENTER entry next to int 0x80 */
+void sysenter_init(void);
+
 #endif /* _IDT_H */
@@ -11,6 +11,9 @@
 #include "sched.h"
 #include "idt.h"
 #include "paging.h"
+#include "frame.h"
+#include "kmalloc.h"
+#include "pipe.h"
 #include "debug.h"
 #include "filesystem.h"
 
@@ -27,7 +30,7 @@ entry (unsigned long magic, unsigned long addr)
 	multiboot_info_t *mbi;
 
 	/* Clear the screen. */
-	clear();
+	video_init();
 
 	/* Am I booted by a Multiboot-compliant boot loader? */
 	if (magic != MULTIBOOT_BOOTLOADER_MAGIC)
@@ -164,8 +167,11 @@ entry (unsigned long magic, unsigned long addr)
 	i8259_init();	// initialize the PIC
 	keyboard_init();	// initialize the keyboard
 	rtc_init();	// initialize the RTC
+	frame_init(mbi);	// free memory for programs, mbi isn't mapped once paging is on
 	paging_init();	// initialize Paging
+	kmalloc_init();	// kernel object caches
 	pc_init();	//initialize process controller
+	pipe_init();	// pipe cache
 	terminal_init();
 	pit_init();
 
@@ -6,6 +6,7 @@
 #include "keyboard.h"
 #include "terminal.h"
 #include "syscall.h"
+#include "sched.h"
 
 #define EXIT_LEN 4
 
@@ -22,7 +23,8 @@ static int ctrl_flag;
 static int alt_flag = 0;
 static int buffer_index[MAX_TERMINAL];
 static unsigned char buffer[MAX_TERMINAL][BUFFER_SIZE]; // three different keyboard buffers
-static volatile int kbdr_flag = 0;
+static volatile int kbdr_flag[MAX_TERMINAL]; // set when enter is pressed in that terminal
+static wait_queue_t kbdr_wait[MAX_TERMINAL]; // readers waiting for enter
 
 /***********************Keyboard Driver****************************/
 
@@ -37,7 +39,7 @@ int32_t keyboard_open(const uint8_t* blank1) {
 /* NM, JC
  * keyboard_read
  *  DESCRIPTION:
- *    Waits for the keyboard handler to be called, then takes the buffer
+ *    Sleeps until the keyboard handler sees enter, then takes the buffer
  *    that was inputed by the user and reads it.
  *  INPUT:
  *    fd - fd index, should be STDIN
@@ -46,17 +48,20 @@ int32_t keyboard_open(const uint8_t* blank1) {
  */
 int32_t keyboard_read(int32_t fd, uint8_t* buf, int32_t nbytes) {
   int count;
-  kbdr_flag = 0;
+  uint32_t flags;
+  uint32_t terminal = sched_terminal; // the line comes from our own terminal
 
   if(buf == NULL)
     return -1;
 
-  while(1){ // get the buffer
-		if(kbdr_flag == 1){
-			count = terminal_retrieve(buf, nbytes);
-			break;
-		}
-  }
+  // sleep until enter is pressed, check the flag with interrupts off so the wake up isn't missed
+  cli_and_save(flags);
+  kbdr_flag[terminal] = 0;
+  while(kbdr_flag[terminal] == 0)
+    sleep_on(&kbdr_wait[terminal]);
+  restore_flags(flags);
+
+  count = terminal_retrieve(buf, nbytes); // get the buffer
 
   // if the sting isn't the command exit, place the '\n' at the end
   if(strncmp((int8_t*)buf, "exit", EXIT_LEN) != 0) // if it's not exit then add this new line
@@ -78,10 +83,13 @@ int32_t keyboard_write(int32_t fd, const void* blank1, int32_t blank2) {
 
 /* AW
  * keyboard_close
- *  empty functionality, should always be open
+ *  stdin is always open, only copies of it made by dup2 can be closed
  */
 int32_t keyboard_close(int32_t fd) {
-    return -1;
+    if(fd < FIRST_VALID_INDEX)
+        return -1;
+    close_fd(fd);
+    return 0;
 }
 
 /**********************************************************************/
@@ -278,6 +286,8 @@ void keyboard_init()
 	{
 		buffer_index[t] = 0;
 		caps_shift_flag[t] = NONE_MODE;
+		kbdr_flag[t] = 0;
+		wait_queue_init(&kbdr_wait[t]);
 	}
 
    enable_irq(KBD_IRQ);    // enable IRQ 1
@@ -301,6 +311,9 @@ void keyboard_handler()
     send_eoi(KBD_IRQ);  // tell PIC to continue with its work
     uint32_t flags;
     cli_and_save(flags);
+    // echo to the displayed terminal, whoever is running
+    uint32_t prev_vid = vid_terminal;
+    vid_terminal = curr_terminal;
     // get input key
     uint8_t key;
     key = inb(KBD_DATA_PORT);
@@ -340,6 +353,7 @@ void keyboard_handler()
             process_key(key);
             break;
     }
+    vid_terminal = prev_vid;
     restore_flags(flags);
 }
 
@@ -475,6 +489,36 @@ void process_key(uint8_t key) {
             clear(); // print file
             print_file_info();
         }
+        // if pressed ctrl and 2s
+        else if(key == TWO_SCAN && ctrl_flag)
+        {
+            clear(); // compare name lookups
+            test_dentry_lookup();
+        }
+        // if pressed ctrl and 5s
+        else if(key == FIVE_SCAN && ctrl_flag)
+        {
+            clear(); // time file reads
+            test_read_throughput();
+        }
+        // if pressed ctrl and 6s
+        else if(key == SIX_SCAN && ctrl_flag)
+        {
+            clear(); // time process switches
+            test_tlb_switch();
+        }
+        // if pressed ctrl and 7s
+        else if(key == SEVEN_SCAN && ctrl_flag)
+        {
+            clear(); // time program launches
+            test_exec_launch();
+        }
+        // if pressed ctrl and 8s
+        else if(key == EIGHT_SCAN && ctrl_flag)
+        {
+            clear(); // change the scheduler's time slice
+            test_next_quantum();
+        }
 
         /**************************/
         else if(buffer_index[curr_terminal] + 1 < BUFFER_SIZE) {
@@ -512,12 +556,13 @@ void handle_backspace() {
  *      SIDE EFFECTS: none
  */
 void handle_enter() {
-	kbdr_flag = 1;
+	kbdr_flag[curr_terminal] = 1;
    scroll();
    //call terminal read once implemented
    // call terminal read, save the buffer
    terminal_read(STDOUT_FD, (uint8_t*)buffer[curr_terminal], buffer_index[curr_terminal]);
    clear_buffer();
+   wake_up(&kbdr_wait[curr_terminal]); // the line is saved, let the reader have it
 }
 
 /* AW
@@ -44,8 +44,13 @@
 #define BKSP         0x0E
 #define ENTER        0x1C
 #define ALT 	 		0x38
+#define EIGHT_SCAN 	0x09
+#define SEVEN_SCAN 	0x08
+#define SIX_SCAN 	0x07
+#define FIVE_SCAN 	0x06
 #define FOUR_SCAN 	0x05
 #define THREE_SCAN 	0x04
+#define TWO_SCAN 	0x03
 #define ONE_SCAN     0x02
 
 #define fn1	0x3B
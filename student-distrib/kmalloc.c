@@ -0,0 +1,309 @@
+/*
+ * kmalloc.c - Slab allocator for kernel objects.
+ *
+ *		A cache hands out objects of one size. It gets 4kb frames from the
+ *		frame allocator and cuts each one into objects, a slab. The slab's
+ *		header sits at the start of its frame, so freeing an object only needs
+ *		the object's address. Slabs with room are kept apart from full ones,
+ *		allocating and freeing never search. A slab that empties out goes back
+ *		to the frame allocator, unless it's the last one with room.
+ */
+
+#include "kmalloc.h"
+#include "frame.h"
+
+#define KMALLOC_PREFIX     "kmalloc-"
+#define KMALLOC_PREFIX_LEN 8
+#define SLAB_HEADER_SIZE   ((sizeof(slab_t) + OBJECT_ALIGN - 1) & ~(OBJECT_ALIGN - 1))
+
+static kmem_cache_t caches[MAX_CACHES]; // a size of 0 marks an unused entry
+static kmem_cache_t* size_caches[KMALLOC_CLASSES];
+
+/*
+ * slab_push - helper
+ *		DESCRIPTION: Puts a slab at the front of a list.
+ *		INPUT: list - head of the list
+ *				 slab - the slab
+ *		RETURN VALUE: none
+ */
+static void slab_push(slab_t** list, slab_t* slab)
+{
+	slab->prev = NULL;
+	slab->next = *list;
+	if(*list != NULL)
+		(*list)->prev = slab;
+	*list = slab;
+}
+
+/*
+ * slab_remove - helper
+ *		DESCRIPTION: Takes a slab out of the list it is in.
+ *		INPUT: list - head of the list
+ *				 slab - the slab
+ *		RETURN VALUE: none
+ */
+static void slab_remove(slab_t** list, slab_t* slab)
+{
+	if(slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		*list = slab->next;
+	if(slab->next != NULL)
+		slab->next->prev = slab->prev;
+}
+
+/*
+ * new_slab - helper
+ *		DESCRIPTION: Gets a frame and chains all of its objects into the free list.
+ *		INPUT: cache - the cache the slab is for
+ *		RETURN VALUE: the slab, NULL if there are no frames left
+ */
+static slab_t* new_slab(kmem_cache_t* cache)
+{
+	int32_t frame = alloc_kernel_frames(1);
+	slab_t* slab;
+	uint8_t* obj;
+	uint32_t i;
+
+	if(frame == -1)
+		return NULL;
+
+	slab = (slab_t*)frame;
+	slab->cache = cache;
+	slab->in_use = 0;
+	slab->free = NULL;
+
+	// chain back to front, so the first object comes out first
+	obj = (uint8_t*)frame + SLAB_HEADER_SIZE + (cache->per_slab - 1) * cache->size;
+	for(i = 0; i < cache->per_slab; i++, obj -= cache->size)
+	{
+		*(void**)obj = slab->free;
+		slab->free = obj;
+	}
+
+	cache->slabs++;
+	return slab;
+}
+
+/*
+ * kmalloc_init
+ *		DESCRIPTION: Makes the caches of the kmalloc size classes.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: needs paging, slabs are reached through the kernel's direct map
+ */
+void kmalloc_init()
+{
+	int8_t name[CACHE_NAME_LENGTH];
+	uint32_t i, size;
+
+	for(i = 0; i < MAX_CACHES; i++)
+		caches[i].size = 0;
+
+	for(i = 0, size = KMALLOC_MIN; i < KMALLOC_CLASSES; i++, size <<= 1)
+	{
+		strcpy(name, KMALLOC_PREFIX);
+		itoa(size, name + KMALLOC_PREFIX_LEN, 10);
+		size_caches[i] = kmem_cache_create(name, size);
+	}
+}
+
+/*
+ * kmem_cache_create
+ *		DESCRIPTION: Makes a cache for objects of one size. Caches are never destroyed.
+ *		INPUT: name - shown in the statistics
+ *				 size - bytes per object
+ *		RETURN VALUE: the cache, NULL if there is no room for another cache
+ *						  or an object doesn't fit in a slab
+ */
+kmem_cache_t* kmem_cache_create(const int8_t* name, uint32_t size)
+{
+	uint32_t flags;
+	uint32_t i;
+	kmem_cache_t* cache = NULL;
+
+	size = (size + OBJECT_ALIGN - 1) & ~(OBJECT_ALIGN - 1); // the free list needs room for a pointer
+	if(size == 0 || size > FRAME_SIZE - SLAB_HEADER_SIZE)
+		return NULL;
+
+	cli_and_save(flags);
+	for(i = 0; i < MAX_CACHES; i++)
+	{
+		if(caches[i].size == 0)
+		{
+			cache = &caches[i];
+			break;
+		}
+	}
+
+	if(cache != NULL)
+	{
+		strncpy(cache->name, name, CACHE_NAME_LENGTH - 1);
+		cache->name[CACHE_NAME_LENGTH - 1] = '\0';
+		cache->size = size;
+		cache->per_slab = (FRAME_SIZE - SLAB_HEADER_SIZE) / size;
+		cache->partial = NULL;
+		cache->full = NULL;
+		cache->slabs = 0;
+		cache->in_use = 0;
+		cache->allocs = 0;
+		cache->frees = 0;
+		cache->failures = 0;
+	}
+
+	restore_flags(flags);
+	return cache;
+}
+
+/*
+ * kmem_cache_alloc
+ *		DESCRIPTION: Takes an object from the cache, getting a new slab if every slab is full.
+ *		INPUT: cache - the cache
+ *		RETURN VALUE: the object, NULL if memory is used up
+ *		SIDE EFFECTS: the object isn't cleared, safe to call from interrupt handlers
+ */
+void* kmem_cache_alloc(kmem_cache_t* cache)
+{
+	uint32_t flags;
+	slab_t* slab;
+	void* obj;
+
+	if(cache == NULL)
+		return NULL;
+
+	cli_and_save(flags);
+
+	if((slab = cache->partial) == NULL)
+	{
+		if((slab = new_slab(cache)) == NULL)
+		{
+			cache->failures++;
+			restore_flags(flags);
+			return NULL;
+		}
+		slab_push(&cache->partial, slab);
+	}
+
+	obj = slab->free;
+	slab->free = *(void**)obj;
+	slab->in_use++;
+	cache->in_use++;
+	cache->allocs++;
+
+	if(slab->free == NULL)
+	{
+		slab_remove(&cache->partial, slab);
+		slab_push(&cache->full, slab);
+	}
+
+	restore_flags(flags);
+	return obj;
+}
+
+/*
+ * kmem_cache_free
+ *		DESCRIPTION: Gives an object back to the cache it came from.
+ *		INPUT: obj - the object, NULL does nothing
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may give the slab's frame back
+ */
+void kmem_cache_free(void* obj)
+{
+	uint32_t flags;
+	slab_t* slab;
+	kmem_cache_t* cache;
+
+	if(obj == NULL)
+		return;
+
+	slab = (slab_t*)((uint32_t)obj & ~(FRAME_SIZE - 1));
+	cache = slab->cache;
+	cli_and_save(flags);
+
+	if(slab->free == NULL)
+	{	// it has room again
+		slab_remove(&cache->full, slab);
+		slab_push(&cache->partial, slab);
+	}
+
+	*(void**)obj = slab->free;
+	slab->free = obj;
+	slab->in_use--;
+	cache->in_use--;
+	cache->frees++;
+
+	// keep one slab with room around, so a single object can't make us thrash
+	if(slab->in_use == 0 && (slab->prev != NULL || slab->next != NULL))
+	{
+		slab_remove(&cache->partial, slab);
+		cache->slabs--;
+		free_kernel_frames((uint32_t)slab, 1);
+	}
+
+	restore_flags(flags);
+}
+
+/*
+ * kmalloc
+ *		DESCRIPTION: Takes an object from the smallest size class that fits.
+ *		INPUT: size - bytes needed
+ *		RETURN VALUE: the object, NULL if size is 0, more than KMALLOC_MAX, or memory is used up
+ *		SIDE EFFECTS: the object isn't cleared
+ */
+void* kmalloc(uint32_t size)
+{
+	uint32_t i, class_size;
+
+	if(size == 0 || size > KMALLOC_MAX)
+		return NULL;
+
+	for(i = 0, class_size = KMALLOC_MIN; class_size < size; i++, class_size <<= 1)
+		;
+	return kmem_cache_alloc(size_caches[i]);
+}
+
+/*
+ * kfree
+ *		DESCRIPTION: Gives back an object from kmalloc.
+ *		INPUT: obj - the object, NULL does nothing
+ *		RETURN VALUE: none
+ */
+void kfree(void* obj)
+{
+	kmem_cache_free(obj);
+}
+
+/*
+ * kmem_stats
+ *		DESCRIPTION: Copies the statistics of every cache, as many as fit.
+ *		INPUT: buf - where the records go
+ *				 nbytes - size of buf
+ *		RETURN VALUE: number of bytes filled
+ */
+int32_t kmem_stats(kmem_stat_t* buf, int32_t nbytes)
+{
+	uint32_t flags;
+	uint32_t i;
+	int32_t filled = 0;
+	cli_and_save(flags);
+
+	for(i = 0; i < MAX_CACHES && filled + (int32_t)sizeof(kmem_stat_t) <= nbytes; i++)
+	{
+		if(caches[i].size == 0)
+			continue;
+
+		strncpy(buf->name, caches[i].name, CACHE_NAME_LENGTH);
+		buf->size = caches[i].size;
+		buf->in_use = caches[i].in_use;
+		buf->total = caches[i].slabs * caches[i].per_slab;
+		buf->slabs = caches[i].slabs;
+		buf->allocs = caches[i].allocs;
+		buf->frees = caches[i].frees;
+		buf->failures = caches[i].failures;
+		buf++;
+		filled += sizeof(kmem_stat_t);
+	}
+
+	restore_flags(flags);
+	return filled;
+}
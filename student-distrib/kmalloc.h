@@ -0,0 +1,68 @@
+/*
+ * kmalloc.h - Slab allocator for kernel objects.
+ *
+ */
+
+#ifndef _KMALLOC_H
+#define _KMALLOC_H
+
+#include "lib.h"
+
+#define MAX_CACHES        16
+#define CACHE_NAME_LENGTH 16
+#define KMALLOC_MIN       16   // smallest kmalloc size class
+#define KMALLOC_MAX       2048 // largest kmalloc size class
+#define KMALLOC_CLASSES   8    // 16, 32, ... 2048 bytes
+#define OBJECT_ALIGN      8
+
+/* one frame of objects of the same size, the header sits at the start of the frame */
+typedef struct slab_t {
+	struct slab_t* next;
+	struct slab_t* prev;
+	struct kmem_cache_t* cache;
+	void* free;		// first free object, each free object holds the next one
+	uint32_t in_use;
+} slab_t;
+
+/* objects of one size */
+typedef struct kmem_cache_t {
+	int8_t name[CACHE_NAME_LENGTH];
+	uint32_t size;		// bytes per object
+	uint32_t per_slab;	// objects in a slab
+	slab_t* partial;	// slabs with at least one free object
+	slab_t* full;		// slabs without a free object
+	uint32_t slabs;
+	uint32_t in_use;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+} kmem_cache_t;
+
+/* what kmstat hands to user space for every cache */
+typedef struct kmem_stat_t {
+	int8_t name[CACHE_NAME_LENGTH];
+	uint32_t size;
+	uint32_t in_use;
+	uint32_t total;		// objects the cache's slabs have room for
+	uint32_t slabs;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+} kmem_stat_t;
+
+/* sets up the kmalloc size classes */
+void kmalloc_init();
+
+/* caches of a single object type */
+kmem_cache_t* kmem_cache_create(const int8_t* name, uint32_t size);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(void* obj);
+
+/* objects up to KMALLOC_MAX bytes from the closest size class */
+void* kmalloc(uint32_t size);
+void kfree(void* obj);
+
+/* fills buf with a kmem_stat_t per cache, returns the bytes filled */
+int32_t kmem_stats(kmem_stat_t* buf, int32_t nbytes);
+
+#endif /* _KMALLOC_H */
@@ -2,14 +2,92 @@
  * vim:ts=4 noexpandtab
  */
 #include "lib.h"
+#include "paging.h" // backup video pages
 #define NUM_COLS 80
 #define NUM_ROWS 25
 #define ATTRIB 0x7
 #define BLUE 0x16
+#define VIDEO_PAGE 0x1000
+#define BLANK ((ATTRIB << 8) | ' ') // a space as a character/attribute word
+#define ROW_BYTES (NUM_COLS << 1)
 static int screen_x[MAX_TERMINAL];
 static int screen_y[MAX_TERMINAL];
-static char* video_mem = (char *)VIDEO;
 
+#ifdef CIRCULAR_SCREEN
+/* every terminal's screen as a ring of rows, screen row y is ring row (top_row + y) */
+static uint16_t screen_rows[MAX_TERMINAL][NUM_ROWS][NUM_COLS];
+static int top_row[MAX_TERMINAL];
+static int stale[MAX_TERMINAL]; // the ring scrolled, video memory is behind
+#endif
+
+static char* term_video(uint32_t terminal);
+static void put_cell(char* video_mem, int x, int y, uint16_t cell);
+static void shift_up(char* video_mem);
+static void redraw(char* video_mem);
+
+/*
+* char* term_video(uint32_t terminal);
+*   Inputs: terminal = terminal whose screen we want
+*   Return Value: start of the memory holding that terminal's screen
+*   Function: Every terminal always draws into its own page of VGA memory,
+*       the displayed one is picked with the display start address.
+*/
+static char*
+term_video(uint32_t terminal)
+{
+    return (char *)(BACKUP_VID1 + terminal*VIDEO_PAGE);
+}
+/*
+* uint32_t term_offset(uint32_t terminal);
+*   Inputs: terminal = terminal whose screen we want
+*   Return Value: where the terminal's page starts, in characters from VIDEO
+*   Function: The VGA start address and cursor registers count in characters
+*/
+static uint32_t
+term_offset(uint32_t terminal)
+{
+    return ((uint32_t)term_video(terminal) - VIDEO) >> 1;
+}
+/*
+* void video_init(void);
+*   Inputs: void
+*   Return Value: none
+*   Function: Blanks the page of every terminal and displays the first one
+*/
+void
+video_init(void)
+{
+    uint32_t t;
+    for(t = 0; t < MAX_TERMINAL; t++) {
+        memset_word(term_video(t), BLANK, NUM_ROWS*NUM_COLS);
+#ifdef CIRCULAR_SCREEN
+        memset_word(screen_rows[t], BLANK, NUM_ROWS*NUM_COLS);
+#endif
+        screen_x[t] = 0;
+        screen_y[t] = 0;
+    }
+    show_terminal(curr_terminal);
+}
+/*
+* void show_terminal(uint32_t terminal);
+*   Inputs: terminal = the terminal to display
+*   Return Value: none
+*   Function: Points the VGA display start address at the terminal's page,
+*       nothing is copied or remapped. Moves the cursor along with it.
+*/
+void
+show_terminal(uint32_t terminal)
+{
+    uint32_t flags;
+    uint32_t offset = term_offset(terminal);
+    cli_and_save(flags);
+    outb(START_LOW_VGA, VGA_SELECT);
+    outb((unsigned char)(offset&0xFF), VGA_DATA);
+    outb(START_HIGH_VGA, VGA_SELECT);
+    outb((unsigned char)((offset>>8)&0xFF), VGA_DATA);
+    restore_flags(flags);
+    update_cursor();
+}
 /*
 * void clear(void);
 *   Inputs: void
@@ -20,13 +98,15 @@ static char* video_mem = (char *)VIDEO;
 void
 clear(void)
 {
-    int32_t i;
-    for(i=0; i<NUM_ROWS*NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
-    }
-    screen_x[curr_terminal] = 0;
-    screen_y[curr_terminal] = 0;
+    char* video_mem = term_video(vid_terminal);
+    memset_word(video_mem, BLANK, NUM_ROWS*NUM_COLS);
+#ifdef CIRCULAR_SCREEN
+    memset_word(screen_rows[vid_terminal], BLANK, NUM_ROWS*NUM_COLS);
+    top_row[vid_terminal] = 0;
+    stale[vid_terminal] = 0;
+#endif
+    screen_x[vid_terminal] = 0;
+    screen_y[vid_terminal] = 0;
     update_cursor();
 }
 /* Standard printf().
@@ -169,34 +249,166 @@ puts(int8_t* s)
 void
 putc(uint8_t c)
 {
+    // a terminal switch must not move the screen out from under us
+    uint32_t flags;
+    cli_and_save(flags);
+    char* video_mem = term_video(vid_terminal);
     // forced next line chracter
     if(c == '\n' || c == '\r') {
-        screen_y[curr_terminal]++;
-        screen_x[curr_terminal] = 0;
+        screen_y[vid_terminal]++;
+        screen_x[vid_terminal] = 0;
         // Check to keep screen_y in bounds upon a '\n'
-        if(screen_y[curr_terminal] >= NUM_ROWS)
+        if(screen_y[vid_terminal] >= NUM_ROWS)
         {
-            screen_y[curr_terminal]--;
-            scroll();
+            screen_y[vid_terminal]--;
+            shift_up(video_mem);
         }
     }
     else {
         // next line by default (wrapping)
-        if(screen_x[curr_terminal] >= NUM_COLS){
-            screen_x[curr_terminal] = 0;
-            screen_y[curr_terminal]++;
+        if(screen_x[vid_terminal] >= NUM_COLS){
+            screen_x[vid_terminal] = 0;
+            screen_y[vid_terminal]++;
             // check to keep screen_y in bounds naturally
-            if(screen_y[curr_terminal] >= NUM_ROWS)
+            if(screen_y[vid_terminal] >= NUM_ROWS)
             {
-                screen_y[curr_terminal]--;
-                scroll();
+                screen_y[vid_terminal]--;
+                shift_up(video_mem);
             }
         }
-        *(uint8_t *)(video_mem + ((NUM_COLS*screen_y[curr_terminal] + screen_x[curr_terminal]) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS*screen_y[curr_terminal] + screen_x[curr_terminal]) << 1) + 1) = ATTRIB;
-        screen_x[curr_terminal]++;
+        put_cell(video_mem, screen_x[vid_terminal], screen_y[vid_terminal], (ATTRIB << 8) | c);
+        screen_x[vid_terminal]++;
     }
+    redraw(video_mem);
     update_cursor();
+    restore_flags(flags);
+}
+/*
+* void write_chars(const uint8_t* buf, int32_t n);
+*   Inputs: const uint8_t* buf = characters to print
+*           int32_t n = how many
+*   Return Value: void
+*   Function: Same output as calling putc on every character, but the
+*       characters between line breaks are written as a run of
+*       character/attribute words and the cursor is only moved once at
+*       the end. With CIRCULAR_SCREEN the screen is redrawn at most once.
+*       Interrupts are off for one row run or scroll at a time, a long
+*       write doesn't hold off the keyboard and the PIT until it's done.
+*/
+void
+write_chars(const uint8_t* buf, int32_t n)
+{
+    uint32_t flags;
+    int32_t i = 0;
+    int32_t run, room;
+    uint16_t* cell;
+    char* video_mem;
+    while(i < n) {
+        // a terminal switch must not move the screen out from under a run
+        cli_and_save(flags);
+        video_mem = term_video(vid_terminal);
+        // forced next line chracter
+        if(buf[i] == '\n' || buf[i] == '\r') {
+            screen_y[vid_terminal]++;
+            screen_x[vid_terminal] = 0;
+            if(screen_y[vid_terminal] >= NUM_ROWS) {
+                screen_y[vid_terminal]--;
+                shift_up(video_mem);
+            }
+            i++;
+            restore_flags(flags);
+            continue;
+        }
+        // next line by default (wrapping)
+        if(screen_x[vid_terminal] >= NUM_COLS) {
+            screen_x[vid_terminal] = 0;
+            screen_y[vid_terminal]++;
+            if(screen_y[vid_terminal] >= NUM_ROWS) {
+                screen_y[vid_terminal]--;
+                shift_up(video_mem);
+            }
+        }
+        // the run stops at a line break or the end of the row
+        room = NUM_COLS - screen_x[vid_terminal];
+#ifdef CIRCULAR_SCREEN
+        cell = &(screen_rows[vid_terminal][(top_row[vid_terminal] + screen_y[vid_terminal]) % NUM_ROWS][screen_x[vid_terminal]]);
+#else
+        cell = (uint16_t *)(video_mem + ((NUM_COLS*screen_y[vid_terminal] + screen_x[vid_terminal]) << 1));
+#endif
+        for(run = 0; run < room && i < n && buf[i] != '\n' && buf[i] != '\r'; run++, i++)
+            cell[run] = (ATTRIB << 8) | buf[i];
+#ifdef CIRCULAR_SCREEN
+        if(!stale[vid_terminal]) // the redraw at the end will cover it otherwise
+            memcpy(video_mem + ((NUM_COLS*screen_y[vid_terminal] + screen_x[vid_terminal]) << 1), cell, run << 1);
+#endif
+        screen_x[vid_terminal] += run;
+        restore_flags(flags);
+    }
+    cli_and_save(flags);
+    redraw(term_video(vid_terminal));
+    update_cursor();
+    restore_flags(flags);
+}
+/*
+* void put_cell(char* video_mem, int x, int y, uint16_t cell)
+*   Inputs: char* video_mem = the screen being written
+*           int x, int y = where on the screen
+*           uint16_t cell = character in the low byte, attribute in the high one
+*   Return Value: void
+*   Function: Writes a single character of the screen
+*/
+static void
+put_cell(char* video_mem, int x, int y, uint16_t cell)
+{
+#ifdef CIRCULAR_SCREEN
+    screen_rows[vid_terminal][(top_row[vid_terminal] + y) % NUM_ROWS][x] = cell;
+    if(stale[vid_terminal])
+        return; // the whole screen gets redrawn anyway
+#endif
+    *(uint16_t *)(video_mem + ((NUM_COLS*y + x) << 1)) = cell;
+}
+/*
+* void shift_up(char* video_mem)
+*   Inputs: char* video_mem = the screen to shift
+*   Return Value: void
+*   Function: Moves every row up by one and blanks the last row,
+*       doesn't touch the cursor. With CIRCULAR_SCREEN only the ring
+*       moves, video memory catches up in redraw.
+*/
+static void
+shift_up(char* video_mem)
+{
+#ifdef CIRCULAR_SCREEN
+    // the old top row becomes the new bottom row
+    memset_word(screen_rows[vid_terminal][top_row[vid_terminal]], BLANK, NUM_COLS);
+    top_row[vid_terminal] = (top_row[vid_terminal] + 1) % NUM_ROWS;
+    stale[vid_terminal] = 1;
+#else
+    // rows 1-24 are contiguous, move them up as one block
+    memmove(video_mem, video_mem + ROW_BYTES, (NUM_ROWS - 1)*ROW_BYTES);
+    // Put spaces on the last row
+    memset_word(video_mem + (NUM_ROWS - 1)*ROW_BYTES, BLANK, NUM_COLS);
+#endif
+}
+/*
+* void redraw(char* video_mem)
+*   Inputs: char* video_mem = the screen to bring up to date
+*   Return Value: void
+*   Function: With CIRCULAR_SCREEN, copies the ring to video memory if it
+*       scrolled since the last redraw, in two pieces since the ring wraps.
+*       Nothing to do otherwise.
+*/
+static void
+redraw(char* video_mem)
+{
+#ifdef CIRCULAR_SCREEN
+    int top = top_row[vid_terminal];
+    if(!stale[vid_terminal])
+        return;
+    memcpy(video_mem, screen_rows[vid_terminal][top], (NUM_ROWS - top)*ROW_BYTES);
+    memcpy(video_mem + (NUM_ROWS - top)*ROW_BYTES, screen_rows[vid_terminal][0], top*ROW_BYTES);
+    stale[vid_terminal] = 0;
+#endif
 }
 /*
 * void scroll()
@@ -205,23 +417,11 @@ putc(uint8_t c)
 *   Function: Manipulate video memory by shifting everything up
 */
 void scroll() {
-    int i, j;
-    if(screen_y[curr_terminal] >= NUM_ROWS - 1) { // if we are writing to the last row...
-        for(i = 0; i < NUM_COLS; i++) {
-            for(j = 0; j < NUM_ROWS - 1; j++) {
-                // Set the value of a given row to the row below it
-                *(uint8_t *)(video_mem + ((NUM_COLS*j + i) << 1)) =
-                    *(uint8_t *)(video_mem + ((NUM_COLS*(j+1) + i) << 1));
-                *(uint8_t *)(video_mem + ((NUM_COLS*j + i) << 1) + 1) =
-                    *(uint8_t *)(video_mem + ((NUM_COLS*(j+1) + i) << 1) + 1);
-            }
-        }
-        // Put spaces on the last row
-        for(i = 0; i < NUM_COLS; i++){
-            *(uint8_t *)(video_mem + ((NUM_COLS*(NUM_ROWS-1) + i) << 1)) = ' ';
-            *(uint8_t *)(video_mem + ((NUM_COLS*(NUM_ROWS-1) + i) << 1) + 1) = ATTRIB;
-        }
-        screen_x[curr_terminal] = 0;
+    char* video_mem = term_video(vid_terminal);
+    if(screen_y[vid_terminal] >= NUM_ROWS - 1) { // if we are writing to the last row...
+        shift_up(video_mem);
+        redraw(video_mem);
+        screen_x[vid_terminal] = 0;
         update_cursor();
     }
     else { // otherwise print a newline
@@ -239,15 +439,15 @@ void scroll() {
 */
 void backspace(void)
 {
-    if((screen_x[curr_terminal] == 0) && (screen_y[curr_terminal] > 0) ) { // check for left edge
-        screen_y[curr_terminal]--;
-        screen_x[curr_terminal] = NUM_COLS - 1;
+    char* video_mem = term_video(vid_terminal);
+    if((screen_x[vid_terminal] == 0) && (screen_y[vid_terminal] > 0) ) { // check for left edge
+        screen_y[vid_terminal]--;
+        screen_x[vid_terminal] = NUM_COLS - 1;
     }
-    else if( (screen_x[curr_terminal] == 0) && (screen_y[curr_terminal] == 0) ) return; // check for first spot
-    else screen_x[curr_terminal]--;
+    else if( (screen_x[vid_terminal] == 0) && (screen_y[vid_terminal] == 0) ) return; // check for first spot
+    else screen_x[vid_terminal]--;
     // Fill with space character
-    *(uint8_t *)(video_mem + ((NUM_COLS*screen_y[curr_terminal] + screen_x[curr_terminal]) << 1)) = ' ';
-    *(uint8_t *)(video_mem + ((NUM_COLS*screen_y[curr_terminal] + screen_x[curr_terminal]) << 1) + 1) = ATTRIB;
+    put_cell(video_mem, screen_x[vid_terminal], screen_y[vid_terminal], BLANK);
     update_cursor();
 }
 /*
@@ -255,13 +455,17 @@ void backspace(void)
 *   Inputs: none
 *   Return Value: void
 *   Function: move the blinking cursor to match the current writing position.
+*       Only the displayed terminal owns the hardware cursor.
 */
 void update_cursor()
 {
+    if(vid_terminal != curr_terminal)
+        return; // background output, the cursor belongs to someone else
     // changing ports, should lock it
     uint32_t flags;
     cli_and_save(flags);
-    unsigned short position = (screen_y[curr_terminal]*NUM_COLS) + screen_x[curr_terminal];
+    // the cursor register counts from VIDEO, not from the displayed page
+    unsigned short position = term_offset(curr_terminal) + (screen_y[curr_terminal]*NUM_COLS) + screen_x[curr_terminal];
     // cursor LOW port to vga INDEX register
     outb(LOW_VGA, VGA_SELECT);
     outb((unsigned char)(position&0xFF), VGA_DATA);
@@ -505,6 +709,7 @@ memmove(void* dest, const void* src, uint32_t n)
             std                     \n\
             .memmove_go:            \n\
             rep     movsb           \n\
+            cld                     \n\
             "
             :
             : "D"(dest), "S"(src), "c"(n)
@@ -592,6 +797,7 @@ void
 test_interrupts(void)
 {
     int32_t i;
+    char* video_mem = term_video(curr_terminal);
     for (i=0; i < NUM_ROWS*NUM_COLS; i++) {
         video_mem[i<<1]++;
     }
@@ -604,6 +810,7 @@ test_interrupts(void)
 */
 void
 show_blue_screen(void) {
+    char* video_mem = term_video(curr_terminal);
     int32_t i;
     for (i=0; i<NUM_ROWS*NUM_COLS; i++) {
         *(uint8_t *)(video_mem + (i << 1) + 1) = BLUE;
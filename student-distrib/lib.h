@@ -12,24 +12,38 @@
 
 #define MAX_TERMINAL 3
 
+/* Uncomment to keep every terminal's screen in a ring of rows. A scroll only
+ * moves the ring and the screen is redrawn once per write, but programs that
+ * draw into video memory themselves get drawn over on the next scroll. */
+// #define CIRCULAR_SCREEN
+
 /*******************************/
 #define LOW_VGA 0x0F
 #define HIGH_VGA 0x0E
 #define VGA_SELECT 0x3D4
 #define VGA_DATA 0x3D5
+#define START_HIGH_VGA 0x0C // display start address, in characters from VIDEO
+#define START_LOW_VGA 0x0D
 /*******************************/
 
+/* cpu */
+#define CPUID_FEATURES 1 // cpuid leaf with the feature bits in edx, idt.h and paging.h test them
+
 volatile uint32_t curr_terminal; // needs to be in lib because it helps with lib.c cursor
 volatile uint32_t old_terminal;
-// volatile int32_t sched_proc;
+volatile uint32_t sched_terminal; // terminal of the process that currently owns the CPU
+volatile uint32_t vid_terminal; // terminal whose screen lib.c output goes to
 
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
+void write_chars(const uint8_t* buf, int32_t n);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
 uint32_t strlen(const int8_t* s);
 void clear(void);
+void video_init(void);
+void show_terminal(uint32_t terminal);
 
 void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
@@ -41,7 +55,7 @@ int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 
 /* Userspace address-check functions */
-int32_t bad_userspace_addr(const void* addr, int32_t len);
+int32_t bad_userspace_addr(const void* addr, int32_t len, int32_t write);
 int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
 
 /*
@@ -149,6 +163,17 @@ static inline uint32_t inl(port)
 	return val;
 }
 
+/* Reads the time stamp counter, the number of cycles since reset */
+static inline uint64_t rdtsc(void)
+{
+	uint64_t val;
+	asm volatile("rdtsc"
+			: "=A"(val)
+			:
+			: "memory" );
+	return val;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
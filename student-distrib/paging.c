@@ -1,4 +1,18 @@
 #include "paging.h"
+#include "frame.h"
+#include "syscall.h"
+#include "terminal.h"
+
+/*
+ * shm_entry - helper
+ *   DESCRIPTION: Whether a mmap window entry maps a shared memory frame
+ *   INPUTS: entry - the page table entry
+ *   RETURN VALUE: 1 - present and from a segment, 0 - anything else
+ */
+static uint32_t shm_entry(uint32_t entry)
+{
+    return (entry & (PRESENT_BIT | SHM_PAGE)) == (PRESENT_BIT | SHM_PAGE);
+}
 
 /*
  * 	paging_init
@@ -15,9 +29,9 @@ void paging_init() {
         page_directory[i] = RW_SET_ONLY;  /* Only R/W is set */
     }
 
-	/* set up memory from (4-8MB) as one 4MB page*/
+	/* set up memory from (4-8MB) as one 4MB page, the same in every process */
     page_directory[1]  = KERNEL_MEM;
-    page_directory[1] |= RW_P_SIZE_SET;
+    page_directory[1] |= RW_P_SIZE_SET | GLOBAL_SET;
 
 	/* split memory from (0-4MB) into 4kb pages */
     page_directory[0]  = (uint32_t) page_table;
@@ -31,14 +45,30 @@ void paging_init() {
 	/* assign video memory a page */
     /* Shifting 12 to get the most significant bits */
     page_table[VIDEO >> TABLE_IDX_SHIFT]  = VIDEO;
-    page_table[VIDEO >> TABLE_IDX_SHIFT] |= RW_P_SET;
+    page_table[VIDEO >> TABLE_IDX_SHIFT] |= RW_P_SET | GLOBAL_SET;
+
+    /* background terminals draw into their backup pages, kernel needs to reach them */
+    page_table[BACKUP_VID1 >> TABLE_IDX_SHIFT] = BACKUP_VID1 | RW_P_SET | GLOBAL_SET;
+    page_table[BACKUP_VID2 >> TABLE_IDX_SHIFT] = BACKUP_VID2 | RW_P_SET | GLOBAL_SET;
+    page_table[BACKUP_VID3 >> TABLE_IDX_SHIFT] = BACKUP_VID3 | RW_P_SET | GLOBAL_SET;
+
+    /* kmap_frame's page, only the kernel can reach it */
+    memset_dword(kmap_page_table, RW_SET_ONLY, PAGE_SIZE);
+    page_directory[KMAP_IDX] = (uint32_t) kmap_page_table | RW_P_SET;
 
     map_virt_to_phys(VIRT_VID_TERM1, BACKUP_VID1);
     map_virt_to_phys(VIRT_VID_TERM2, BACKUP_VID2);
     map_virt_to_phys(VIRT_VID_TERM3, BACKUP_VID3);
 
+    /* the kernel reaches the frames it allocates at their physical address */
+    for(i = FIRST_FRAME >> DIR_IDX_SHIFT; i < DIRECT_MAP_END >> DIR_IDX_SHIFT; i++)
+        page_directory[i] = (i << DIR_IDX_SHIFT) | RW_P_SIZE_SET | GLOBAL_SET;
+
 	/* in line assembly for paging initialization */
     enablePaging();
+
+    /* kernel pages survive process switches */
+    set_global_pages(1);
 }
 
 /*
@@ -50,8 +80,60 @@ void paging_init() {
  *   SIDE EFFECTS: 
  */
 void add_process(uint32_t process_id) {
-    page_directory[PROCESS_IDX] = (USER_SPACE + process_id * PROCESS_SIZE_) | PROCESS_SET;
-    flush_tlb();
+    page_directory[PROCESS_IDX] = (uint32_t) process_array[process_id]->program_table | USER_MASK; // its program pages
+    page_directory[MMAP_IDX] = (uint32_t) process_array[process_id]->mmap_table | USER_MASK; // its file mappings
+    flush_tlb(); // only the user pages, the kernel's are global
+}
+
+/*
+ * alloc_page_tables
+ *   DESCRIPTION: Gives a process an empty table for its program page and one
+ *      for its file mappings, kept until free_page_tables
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process, its pcb has to exist
+ *   RETURN VALUE: 0 - success, -1 - out of frames
+ *   SIDE EFFECTS: none
+ */
+int32_t alloc_page_tables(uint32_t process_id)
+{
+    pcb* process = process_array[process_id];
+    int32_t program_table = alloc_kernel_frames(1);
+    int32_t mmap_table = alloc_kernel_frames(1);
+
+    if(program_table == -1 || mmap_table == -1)
+    {
+        if(program_table != -1)
+            free_kernel_frames(program_table, 1);
+        if(mmap_table != -1)
+            free_kernel_frames(mmap_table, 1);
+        return -1;
+    }
+
+    process->program_table = (uint32_t*)program_table;
+    process->mmap_table = (uint32_t*)mmap_table;
+    memset_dword(process->program_table, RW_SET_ONLY, PAGE_SIZE); // not present
+    memset_dword(process->mmap_table, RW_SET_ONLY, PAGE_SIZE);
+    return 0;
+}
+
+/*
+ * free_page_tables
+ *   DESCRIPTION: Gives the frames of a process and its page tables back
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process, must not be the one paged in
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: none
+ */
+void free_page_tables(uint32_t process_id)
+{
+    pcb* process = process_array[process_id];
+
+    free_process_pages(process_id);
+    clear_user_pages(process_id);
+    free_kernel_frames((uint32_t)process->program_table, 1);
+    free_kernel_frames((uint32_t)process->mmap_table, 1);
+    process->program_table = NULL;
+    process->mmap_table = NULL;
 }
 
 /*
@@ -69,9 +151,360 @@ void map_virt_to_phys(uint32_t virtual_address, uint32_t PHYS)
     // give a user a table
     page_directory[virtual_address>>DIR_IDX_SHIFT] = (uint32_t) user_page_table | USER_MASK; // shift to find index into page directory
     user_page_table[(virtual_address & CLEAR_DIR_IDX)>>TABLE_IDX_SHIFT] = PHYS | RW_P_SET; // map the page table
+    flush_tlb_page(virtual_address); // only this page changed
+}
+
+/*
+ * map_process_pages
+ *   DESCRIPTION: Gives num_pages pages of the program page of a process a frame each,
+ *      pages that already have one keep it
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the pages belong to
+ *           virtual_address - first page, inside the program page
+ *           num_pages - how many 4kb pages
+ *   RETURN VALUE: 0 - success, -1 - out of frames, the pages mapped so far stay
+ *   SIDE EFFECTS: the frames aren't cleared, the caller flushes the TLB
+ */
+int32_t map_process_pages(uint32_t process_id, uint32_t virtual_address, uint32_t num_pages)
+{
+    uint32_t* table = process_array[process_id]->program_table;
+    uint32_t first = (virtual_address & CLEAR_DIR_IDX) >> TABLE_IDX_SHIFT;
+    uint32_t i;
+    int32_t frame;
+
+    if(num_pages > PAGE_SIZE - first)
+        return -1;
+
+    for(i = first; i < first + num_pages; i++)
+    {
+        if(table[i] & PRESENT_BIT)
+            continue;
+        if((frame = alloc_frame()) == -1)
+            return -1;
+        table[i] = frame | USER_MASK;
+    }
+    return 0;
+}
+
+/*
+ * free_process_pages
+ *   DESCRIPTION: Gives every frame of the program page of a process back,
+ *      shared pages are only unmapped
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the pages belong to
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: none, the caller flushes the TLB
+ */
+void free_process_pages(uint32_t process_id)
+{
+    uint32_t* table = process_array[process_id]->program_table;
+    uint32_t i;
+    for(i = 0; i < PAGE_SIZE; i++)
+    {
+        if((table[i] & PRESENT_BIT) && !(table[i] & SHARED_PAGE))
+            free_frame(table[i] & ~ENTRY_FLAGS);
+        table[i] = RW_SET_ONLY; // not present
+    }
+}
+
+/*
+ * kmap_frame - helper
+ *   DESCRIPTION: Maps any frame at KMAP_START for the kernel, until the next call
+ *   OUTPUTS: none
+ *   INPUTS: phys - the frame
+ *   RETURN VALUE: where the frame can be reached
+ *   SIDE EFFECTS: interrupts have to be off while the page is used
+ */
+static void* kmap_frame(uint32_t phys)
+{
+    kmap_page_table[0] = phys | RW_P_SET;
+    flush_tlb_page(KMAP_START);
+    return (void*)KMAP_START;
+}
+
+/*
+ * user_to_phys
+ *   DESCRIPTION: Finds the physical address a user address of the running
+ *      process is mapped to
+ *   OUTPUTS: none
+ *   INPUTS: virtual_address - an address bad_userspace_addr passed
+ *   RETURN VALUE: the physical address
+ *   SIDE EFFECTS: none
+ */
+uint32_t user_to_phys(uint32_t virtual_address)
+{
+    uint32_t entry = page_directory[virtual_address >> DIR_IDX_SHIFT];
+    uint32_t* table;
+
+    if(entry & SIZE_BIT)
+        return (entry & ~CLEAR_DIR_IDX) | (virtual_address & CLEAR_DIR_IDX);
+
+    table = (uint32_t*)(entry & ~ENTRY_FLAGS);
+    entry = table[(virtual_address & CLEAR_DIR_IDX) >> TABLE_IDX_SHIFT];
+    return (entry & ~ENTRY_FLAGS) | (virtual_address & ENTRY_FLAGS);
+}
+
+/*
+ * clear_frame
+ *   DESCRIPTION: Zeroes a frame, it doesn't have to be mapped anywhere
+ *   OUTPUTS: none
+ *   INPUTS: phys - the frame
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: none
+ */
+void clear_frame(uint32_t phys)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+    memset_dword(kmap_frame(phys), 0, PAGE_SIZE);
+    restore_flags(flags);
+}
+
+/*
+ * fork_pages
+ *   DESCRIPTION: Gives the child the parent's pages. Its own frames become read
+ *      only and shared by both, the first write copies them.
+ *   OUTPUTS: none
+ *   INPUTS: parent_id - the running process
+ *           child_id - the new process, its page tables are empty
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: flushes the TLB, the parent's pages became read only
+ */
+void fork_pages(uint32_t parent_id, uint32_t child_id)
+{
+    uint32_t* parent = process_array[parent_id]->program_table;
+    uint32_t* child = process_array[child_id]->program_table;
+    uint32_t i;
+
+    for(i = 0; i < PAGE_SIZE; i++)
+    {
+        if((parent[i] & PRESENT_BIT) && !(parent[i] & SHARED_PAGE))
+        {
+            parent[i] = (parent[i] & ~RW_SET_ONLY) | COW_PAGE;
+            share_frame(parent[i] & ~ENTRY_FLAGS);
+        }
+        child[i] = parent[i];
+    }
+
+    // the file mappings point at the file system, they can just be copied,
+    // shared memory stays shared
+    parent = process_array[parent_id]->mmap_table;
+    child = process_array[child_id]->mmap_table;
+    for(i = 0; i < PAGE_SIZE; i++)
+    {
+        if(shm_entry(parent[i]))
+            share_frame(parent[i] & ~ENTRY_FLAGS);
+        child[i] = parent[i];
+    }
     flush_tlb();
 }
 
+/*
+ * copy_on_write
+ *   DESCRIPTION: First write to a page fork shared. The process gets its own copy,
+ *      or the frame itself if nobody else maps it anymore.
+ *   OUTPUTS: none
+ *   INPUTS: virtual_address - any address in the page, in the running process
+ *   RETURN VALUE: 0 - the page is writable now, -1 - not a shared page, or out of memory
+ *   SIDE EFFECTS: none
+ */
+int32_t copy_on_write(uint32_t virtual_address)
+{
+    uint32_t* entry;
+    uint32_t page = virtual_address & ~ENTRY_FLAGS;
+    uint32_t phys, flags;
+    int32_t frame;
+
+    if(virtual_address < PROGRAM_PAGE || virtual_address >= PROGRAM_PAGE + USER_PAGE_SIZE)
+        return -1;
+
+    entry = &process_array[current_process[sched_terminal]]->program_table[(page & CLEAR_DIR_IDX) >> TABLE_IDX_SHIFT];
+    if(!(*entry & PRESENT_BIT) || !(*entry & COW_PAGE))
+        return -1;
+
+    cli_and_save(flags);
+    phys = *entry & ~ENTRY_FLAGS;
+    if(frame_references(phys) > 1)
+    {
+        if((frame = alloc_frame()) == -1)
+        {
+            restore_flags(flags);
+            return -1;
+        }
+        memcpy(kmap_frame(frame), (void*)page, PAGE_ALIGN);
+        free_frame(phys); // one sharer less
+        phys = frame;
+    }
+
+    *entry = phys | USER_MASK;
+    flush_tlb_page(page);
+    restore_flags(flags);
+    return 0;
+}
+
+/*
+ * bad_userspace_addr
+ *   DESCRIPTION: Checks that a buffer a system call got is mapped for the user
+ *      in the running process, a program only has the pages it was given.
+ *      Pages of the program image it hasn't touched yet are loaded, and shared
+ *      ones the kernel is going to write get copied.
+ *   OUTPUTS: none
+ *   INPUTS: addr - start of the buffer
+ *           len - its size in bytes
+ *           write - 1 if the kernel is going to write into it
+ *   RETURN VALUE: 0 - the whole buffer is fine, 1 - it isn't
+ *   SIDE EFFECTS: none
+ */
+int32_t bad_userspace_addr(const void* addr, int32_t len, int32_t write)
+{
+    uint32_t need = write ? USER_MASK : USER_READ_ONLY;
+    uint32_t page, last, entry;
+
+    if(addr == NULL || len < 0 || (uint32_t)addr + len < (uint32_t)addr)
+        return 1;
+    if(len == 0)
+        return 0;
+
+    last = ((uint32_t)addr + len - 1) & ~ENTRY_FLAGS;
+    for(page = (uint32_t)addr & ~ENTRY_FLAGS; ; page += PAGE_ALIGN)
+    {
+        entry = page_directory[page >> DIR_IDX_SHIFT];
+        if((entry & need) != need)
+            return 1;
+        if(!(entry & SIZE_BIT))
+        {
+            uint32_t* table = (uint32_t*)(entry & ~ENTRY_FLAGS);
+            uint32_t index = (page & CLEAR_DIR_IDX) >> TABLE_IDX_SHIFT;
+
+            // the kernel shouldn't fault on a program page that wasn't loaded or copied yet
+            if(write && (table[index] & COW_PAGE))
+                copy_on_write(page);
+            if(!(table[index] & PRESENT_BIT) || (write && !(table[index] & RW_SET_ONLY)))
+                load_image_page(page, write);
+            if((table[index] & need) != need)
+                return 1;
+        }
+        if(page == last)
+            return 0;
+    }
+}
+
+/*
+ * find_map_pages
+ *   DESCRIPTION: Finds the first run of unused pages in the file mapping window
+ *      of a process that is long enough
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process that wants to map something
+ *           num_pages - how many 4kb pages it needs
+ *   RETURN VALUE: virtual address of the first page, -1 if it doesn't fit
+ *   SIDE EFFECTS: none
+ */
+int32_t find_map_pages(uint32_t process_id, uint32_t num_pages)
+{
+    uint32_t* table = process_array[process_id]->mmap_table;
+    uint32_t i;
+    uint32_t run = 0; // free pages in a row so far
+
+    if(num_pages == 0)
+        return -1;
+
+    for(i = 0; i < PAGE_SIZE; i++)
+    {
+        if(table[i] & PRESENT_BIT)
+            run = 0;
+        else if(++run == num_pages)
+            return MMAP_START + ((i + 1 - num_pages) << TABLE_IDX_SHIFT);
+    }
+    return -1;
+}
+
+/*
+ * map_user_page
+ *   DESCRIPTION: Maps a 4kb page of the file mapping window of a process, read only.
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the window belongs to
+ *           virtual_address - page in the window
+ *           PHYS - 4kb aligned physical address
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: changes the process's mmap page table
+ */
+void map_user_page(uint32_t process_id, uint32_t virtual_address, uint32_t PHYS)
+{
+    process_array[process_id]->mmap_table[(virtual_address & CLEAR_DIR_IDX)>>TABLE_IDX_SHIFT] = PHYS | USER_READ_ONLY;
+    flush_tlb_page(virtual_address);
+}
+
+/*
+ * map_shared_page
+ *   DESCRIPTION: Maps a page of a shared memory segment in the file mapping
+ *      window of a process, writable. The page counts as a reference to the frame.
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the window belongs to
+ *           virtual_address - page in the window
+ *           PHYS - a frame from alloc_frame
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: changes the process's mmap page table
+ */
+void map_shared_page(uint32_t process_id, uint32_t virtual_address, uint32_t PHYS)
+{
+    share_frame(PHYS);
+    process_array[process_id]->mmap_table[(virtual_address & CLEAR_DIR_IDX)>>TABLE_IDX_SHIFT] = PHYS | USER_MASK | SHM_PAGE;
+    flush_tlb_page(virtual_address);
+}
+
+/*
+ * unmap_user_pages
+ *   DESCRIPTION: Removes num_pages pages of the file mapping window of a process
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the window belongs to
+ *           virtual_address - first page to remove
+ *           num_pages - how many pages
+ *   RETURN VALUE: 0 - success, -1 - not inside the window
+ *   SIDE EFFECTS: drops the pages from the TLB
+ */
+int32_t unmap_user_pages(uint32_t process_id, uint32_t virtual_address, uint32_t num_pages)
+{
+    uint32_t first, i;
+
+    // past the window first would run off the end of the table
+    if(virtual_address < MMAP_START || virtual_address >= MMAP_START + USER_PAGE_SIZE
+            || (virtual_address & (PAGE_ALIGN - 1)))
+        return -1;
+
+    first = (virtual_address - MMAP_START) >> TABLE_IDX_SHIFT;
+    if(num_pages > PAGE_SIZE - first)
+        return -1;
+
+    for(i = first; i < first + num_pages; i++)
+    {
+        if(shm_entry(process_array[process_id]->mmap_table[i]))
+            free_frame(process_array[process_id]->mmap_table[i] & ~ENTRY_FLAGS);
+        process_array[process_id]->mmap_table[i] = RW_SET_ONLY; // not present
+        flush_tlb_page(MMAP_START + (i << TABLE_IDX_SHIFT));
+    }
+    return 0;
+}
+
+/*
+ * clear_user_pages
+ *   DESCRIPTION: Removes every file mapping and shared memory page of a process
+ *   OUTPUTS: none
+ *   INPUTS: process_id - the process the window belongs to
+ *   RETURN VALUE: None
+ *   SIDE EFFECTS: none, the caller flushes the TLB
+ */
+void clear_user_pages(uint32_t process_id)
+{
+    uint32_t* table = process_array[process_id]->mmap_table;
+    uint32_t i;
+    for(i = 0; i < PAGE_SIZE; i++)
+    {
+        if(shm_entry(table[i]))
+            free_frame(table[i] & ~ENTRY_FLAGS);
+        table[i] = RW_SET_ONLY; // not present
+    }
+}
+
 /*
  * enablePaging
  *   DESCRIPTION: Helper function to handle in-line-assembly for
@@ -91,23 +524,23 @@ void enablePaging() {
         : "r" (page_directory)
     );
 
-    /* Sets PSE and PAE flag */
+    /* Sets PSE flag, for the 4MB pages */
     asm volatile(
         "movl %%cr4, %%eax;"
-        "orl  $0x00000010, %%eax;"
+        "orl  %0, %%eax;"
         "movl %%eax, %%cr4;"
     :	/* No outputs */
-    :	/* No inputs */
+    :	"i" (CR4_PSE)
     :   "%eax" /* clobbers eax */
     );
 
-    /* Sets PG flag */
+    /* Sets PG flag, and WP so the kernel can't write into a shared read only page */
     asm volatile(
         "movl  %%cr0, %%eax;"
-        "orl  $0x80000000, %%eax;"
+        "orl  %0, %%eax;"
         "movl %%eax, %%cr0;"
     :	/* No outputs */
-    :	/* No inputs */
+    :	"i" (CR0_PG | CR0_WP)
     : "%eax" /* clobbers eax */
     );
 }
@@ -121,3 +554,50 @@ void flush_tlb() {
      :"%eax"                /* clobbered register */
      );
 }
+
+/*
+ * flush_tlb_page
+ *   DESCRIPTION: Drops the translation of a single page from the TLB,
+ *      cheaper than reloading CR3 when only one mapping changed
+ *   INPUTS: virtual_address - any address in the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void flush_tlb_page(uint32_t virtual_address)
+{
+    asm volatile(
+     "invlpg (%0)"
+     :
+     : "r"(virtual_address)
+     : "memory"
+     );
+}
+
+/*
+ * set_global_pages
+ *   DESCRIPTION: Turns CR4.PGE on or off. Global pages aren't dropped when
+ *      CR3 is reloaded, turning it off drops everything.
+ *   INPUTS: on - 1 to turn global pages on, 0 to turn them off
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: nothing happens if the processor doesn't have global pages
+ */
+void set_global_pages(uint32_t on)
+{
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t cr4;
+
+    asm volatile("cpuid"
+            : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+            : "a"(CPUID_FEATURES));
+    if(!(edx & CPUID_PGE))
+        return;
+
+    asm volatile("movl %%cr4, %0" : "=r"(cr4));
+    if(on)
+        cr4 |= CR4_PGE;
+    else
+        cr4 &= ~CR4_PGE;
+    asm volatile("movl %0, %%cr4" : : "r"(cr4) : "memory");
+}
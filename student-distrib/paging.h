@@ -24,7 +24,7 @@
 #define RW_SET_ONLY   0x00000002  // Set bit 1, enables r/w
 #define RW_P_SET      (RW_SET_ONLY | 0x00000001) // Set bit 0, enables present bit
 #define RW_P_SIZE_SET (RW_P_SET    | 0x00000080) // Set bit 7, enables larger page size
-#define PROCESS_SET   0x00000087 // Set size, user, r/w, present
+#define GLOBAL_SET    0x00000100 // Set bit 8, stays in the TLB when CR3 is reloaded
 #define USER_MASK     0x7		//set 4kb size, user, r/w, present
 #define USER_VIDEO_ 	 (VIDEO | USER_MASK) //set user video memory page (4kb)
 // set user video mem for back up 1, 2, and 3
@@ -32,16 +32,37 @@
 #define USER_BACK2	 (BACKUP_VID2 | USER_MASK)
 #define USER_BACK3	 (BACKUP_VID3 | USER_MASK)
 
-#define USER_SPACE    0x00800000  
-#define PROCESS_SIZE_ 0x00400000
+// file mappings, every process gets its own 4MB window right after the vidmap pages
+#define MMAP_START    0x10400000
+#define MMAP_IDX      (MMAP_START >> DIR_IDX_SHIFT)
+#define USER_READ_ONLY 0x5       // 4kb, user, present, no r/w
+#define PRESENT_BIT   0x1
+#define SIZE_BIT      0x80       // 4MB page
+#define ENTRY_FLAGS   0xFFF      // low bits of an entry, the rest is the address
+#define SHARED_PAGE   0x200      // available bit 9, the frame isn't the process's own
+#define COW_PAGE      0x400      // available bit 10, read only until written, then copied
+#define SHM_PAGE      0x800      // available bit 11, a frame of a shared memory segment
+
+// control register bits
+#define CR0_PG        0x80000000 // paging
+#define CR0_WP        0x00010000 // the kernel can't write to read only pages either
+#define CR4_PSE       0x00000010 // 4MB pages
+#define CR4_PGE       0x00000080 // global pages
+#define CPUID_PGE     0x00002000 // edx bit 13 of CPUID_FEATURES
+
 #define PROCESS_IDX   32
 
+// one kernel page to reach a frame the direct map doesn't cover
+#define KMAP_START    0x0FC00000
+#define KMAP_IDX      (KMAP_START >> DIR_IDX_SHIFT)
+
 /* page directory */
 uint32_t page_directory[PAGE_SIZE] __attribute__((aligned(PAGE_ALIGN)));
 
 /* page table for video memory */
 uint32_t page_table[PAGE_SIZE] __attribute__((aligned(PAGE_ALIGN)));
 uint32_t user_page_table[PAGE_SIZE] __attribute__((aligned(PAGE_ALIGN)));
+uint32_t kmap_page_table[PAGE_SIZE] __attribute__((aligned(PAGE_ALIGN)));
 
 /* initializes paging */
 void paging_init();
@@ -49,13 +70,44 @@ void paging_init();
 /* helper function to enable paging (in-line-assembly) */
 void enablePaging();
 
-/* allocate page for a new process */
+/* switch to the pages of a process */
 void add_process(uint32_t process_id);
 
+/* the two page tables of a process, its program page and its file mappings */
+int32_t alloc_page_tables(uint32_t process_id);
+void free_page_tables(uint32_t process_id);
+
 /* allocate video memory page for user */
 void map_virt_to_phys(uint32_t virtual_address, uint32_t PHYS);
 
-/* clear the TLB */
+/* program pages of a process, backed by frames from the frame allocator */
+int32_t map_process_pages(uint32_t process_id, uint32_t virtual_address, uint32_t num_pages);
+void free_process_pages(uint32_t process_id);
+
+/* fork, the child shares the parent's pages until one of them writes */
+void fork_pages(uint32_t parent_id, uint32_t child_id);
+int32_t copy_on_write(uint32_t virtual_address);
+
+/* file mappings of a process, read only, and shared memory segments */
+int32_t find_map_pages(uint32_t process_id, uint32_t num_pages);
+void map_user_page(uint32_t process_id, uint32_t virtual_address, uint32_t PHYS);
+void map_shared_page(uint32_t process_id, uint32_t virtual_address, uint32_t PHYS);
+int32_t unmap_user_pages(uint32_t process_id, uint32_t virtual_address, uint32_t num_pages);
+void clear_user_pages(uint32_t process_id);
+
+/* physical address behind a user address the caller checked */
+uint32_t user_to_phys(uint32_t virtual_address);
+
+/* zero a frame from alloc_frame, wherever it is */
+void clear_frame(uint32_t phys);
+
+/* clear the TLB, global pages stay */
 void flush_tlb();
 
+/* drop a single page from the TLB */
+void flush_tlb_page(uint32_t virtual_address);
+
+/* turn global pages on or off, turning them off flushes them */
+void set_global_pages(uint32_t on);
+
 #endif
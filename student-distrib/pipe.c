@@ -0,0 +1,278 @@
+/*
+ * pipe.c - Pipes between processes.
+ *
+ *		A pipe is a ring buffer with a read end and a write end. Both ends are
+ *		ordinary descriptors, fork and execute hand them down like any other.
+ *		Readers sleep while the pipe is empty and writers while it is full.
+ *		Reading an empty pipe nobody can write to anymore is the end of file,
+ *		writing to one nobody can read anymore fails. The pipe goes away with
+ *		the last descriptor of either end.
+ */
+
+#include "pipe.h"
+#include "syscall.h"
+
+static kmem_cache_t* pipe_cache;
+
+/*
+ * pipe_init
+ *		DESCRIPTION: Makes the cache pipes come from.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: needs kmalloc_init
+ */
+void pipe_init()
+{
+	pipe_cache = kmem_cache_create("pipe", sizeof(pipe_t));
+}
+
+/*
+ * pipe_create
+ *		DESCRIPTION:
+ *			Makes a pipe and opens both of its ends in the running process.
+ *		INPUT: fds - filled with the read end, then the write end
+ *		RETURN VALUE: 0 - success
+ *						  -1 - no free descriptors, or out of memory
+ */
+int32_t pipe_create(int32_t* fds)
+{
+	int32_t read_fd, write_fd;
+	fd_t file_info;
+	pipe_t* pipe;
+
+	if((read_fd = get_fd_index()) == -1)
+		return -1;
+
+	file_info.fd_jump = &pipe_read_ops_table;
+	file_info.inode_ptr = -1;
+	file_info.file_position = 0;
+	file_info.flags = FD_ON;
+	file_info.rtc_freq = 0;
+	file_info.rtc_ticks = 0;
+	file_info.pipe = NULL;
+	set_fd_info(read_fd, file_info); // takes the index, so the write end gets another
+
+	if((write_fd = get_fd_index()) == -1)
+	{
+		close_fd(read_fd);
+		return -1;
+	}
+
+	if((pipe = kmem_cache_alloc(pipe_cache)) == NULL)
+	{
+		close_fd(read_fd);
+		return -1;
+	}
+	if((pipe->buffer = kmalloc(PIPE_SIZE)) == NULL)
+	{
+		kmem_cache_free(pipe);
+		close_fd(read_fd);
+		return -1;
+	}
+	pipe->head = 0;
+	pipe->count = 0;
+	pipe->readers = 1;
+	pipe->writers = 1;
+	wait_queue_init(&pipe->readable);
+	wait_queue_init(&pipe->writable);
+
+	get_fd(read_fd)->pipe = pipe;
+	file_info.fd_jump = &pipe_write_ops_table;
+	file_info.pipe = pipe;
+	set_fd_info(write_fd, file_info);
+
+	fds[0] = read_fd;
+	fds[1] = write_fd;
+	return 0;
+}
+
+/*
+ * is_pipe
+ *		DESCRIPTION: Tells whether a descriptor is an end of a pipe.
+ *		INPUT: fd - the descriptor
+ *		RETURN VALUE: 1 - it is, 0 - it isn't
+ */
+int32_t is_pipe(fd_t* fd)
+{
+	return fd->flags == FD_ON &&
+		(fd->fd_jump == &pipe_read_ops_table || fd->fd_jump == &pipe_write_ops_table);
+}
+
+/*
+ * pipe_dup
+ *		DESCRIPTION: Counts a copy of a descriptor, fork and execute copy them.
+ *		INPUT: fd - the new copy
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: does nothing if fd isn't a pipe end
+ */
+void pipe_dup(fd_t* fd)
+{
+	uint32_t flags;
+
+	if(!is_pipe(fd))
+		return;
+
+	cli_and_save(flags);
+	if(fd->fd_jump == &pipe_read_ops_table)
+		fd->pipe->readers++;
+	else
+		fd->pipe->writers++;
+	restore_flags(flags);
+}
+
+/*
+ * pipe_release
+ *		DESCRIPTION:
+ *			Drops a descriptor of a pipe end. Wakes whoever waits on the other
+ *			end, they may have nobody left to wait for. The last descriptor
+ *			frees the pipe.
+ *		INPUT: fd - the descriptor going away
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: does nothing if fd isn't a pipe end, the descriptor isn't closed
+ */
+void pipe_release(fd_t* fd)
+{
+	uint32_t flags;
+	pipe_t* pipe = fd->pipe;
+
+	if(!is_pipe(fd))
+		return;
+
+	cli_and_save(flags);
+	if(fd->fd_jump == &pipe_read_ops_table)
+		pipe->readers--;
+	else
+		pipe->writers--;
+	fd->pipe = NULL;
+
+	wake_up(&pipe->readable);
+	wake_up(&pipe->writable);
+	if(pipe->readers == 0 && pipe->writers == 0)
+	{
+		kfree(pipe->buffer);
+		kmem_cache_free(pipe);
+	}
+	restore_flags(flags);
+}
+
+/*
+ * pipe_open
+ *		DESCRIPTION: Pipes have no name, only the pipe system call makes them.
+ *		INPUT: filename - ignored
+ *		RETURN VALUE: -1
+ */
+int32_t pipe_open(const uint8_t* filename)
+{
+	return -1;
+}
+
+/*
+ * pipe_read
+ *		DESCRIPTION:
+ *			Takes up to nbytes out of the pipe. Sleeps until there is something
+ *			to read, then returns what is there without waiting for more.
+ *		INPUT: fd - a read end
+ *				 buf - where the bytes go
+ *				 nbytes - the most to read
+ *		RETURN VALUE: number of bytes read, 0 once the pipe is empty and has no writers left
+ */
+int32_t pipe_read(int32_t fd, uint8_t* buf, int32_t nbytes)
+{
+	uint32_t flags;
+	int32_t i;
+	pipe_t* pipe = get_fd(fd)->pipe;
+
+	if(nbytes <= 0)
+		return nbytes < 0 ? -1 : 0; // reading nothing never waits
+
+	cli_and_save(flags);
+	while(pipe->count == 0 && pipe->writers > 0)
+		sleep_on(&pipe->readable);
+
+	for(i = 0; i < nbytes && pipe->count > 0; i++)
+	{
+		buf[i] = pipe->buffer[pipe->head];
+		pipe->head = (pipe->head + 1) % PIPE_SIZE;
+		pipe->count--;
+	}
+
+	if(i > 0)
+		wake_up(&pipe->writable);
+	restore_flags(flags);
+	return i;
+}
+
+/*
+ * pipe_write
+ *		DESCRIPTION:
+ *			Puts all nbytes into the pipe, sleeping whenever it is full. Stops
+ *			early if the last reader goes away.
+ *		INPUT: fd - a write end
+ *				 buf - the bytes to write
+ *				 nbytes - how many
+ *		RETURN VALUE: number of bytes written, -1 if nobody could read any of them
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+	uint32_t flags;
+	int32_t i = 0;
+	pipe_t* pipe = get_fd(fd)->pipe;
+
+	if(nbytes < 0)
+		return -1;
+
+	cli_and_save(flags);
+	while(i < nbytes && pipe->readers > 0)
+	{
+		if(pipe->count == PIPE_SIZE)
+		{
+			sleep_on(&pipe->writable);
+			continue;
+		}
+
+		for(; i < nbytes && pipe->count < PIPE_SIZE; i++)
+		{
+			pipe->buffer[(pipe->head + pipe->count) % PIPE_SIZE] = ((const uint8_t*)buf)[i];
+			pipe->count++;
+		}
+		wake_up(&pipe->readable);
+	}
+	restore_flags(flags);
+
+	return (i == 0 && nbytes > 0) ? -1 : i;
+}
+
+/*
+ * pipe_close
+ *		DESCRIPTION: Closes one descriptor of a pipe end.
+ *		INPUT: fd - the descriptor
+ *		RETURN VALUE: 0
+ */
+int32_t pipe_close(int32_t fd)
+{
+	pipe_release(get_fd(fd));
+	close_fd(fd);
+	return 0;
+}
+
+/*
+ * pipe_no_read
+ *		DESCRIPTION: The write end can't be read.
+ *		INPUT: ignored
+ *		RETURN VALUE: -1
+ */
+int32_t pipe_no_read(int32_t fd, uint8_t* buf, int32_t nbytes)
+{
+	return -1;
+}
+
+/*
+ * pipe_no_write
+ *		DESCRIPTION: The read end can't be written.
+ *		INPUT: ignored
+ *		RETURN VALUE: -1
+ */
+int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes)
+{
+	return -1;
+}
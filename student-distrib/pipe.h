@@ -0,0 +1,46 @@
+/*
+ * pipe.h - Declarations for pipes between processes.
+ *
+ */
+
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "lib.h"
+#include "fd_table.h"
+#include "sched.h"
+#include "kmalloc.h"
+
+#define PIPE_SIZE KMALLOC_MAX // bytes a pipe holds before writers have to wait
+
+/* a ring buffer shared by every descriptor of both ends */
+typedef struct pipe_t {
+	uint8_t* buffer;		// PIPE_SIZE bytes from kmalloc
+	uint32_t head;			// next byte to read
+	uint32_t count;		// bytes waiting to be read
+	uint32_t readers;		// read end descriptors, in every process
+	uint32_t writers;		// write end descriptors, in every process
+	wait_queue_t readable;	// readers waiting for data
+	wait_queue_t writable;	// writers waiting for room
+} pipe_t;
+
+/* makes the pipe cache */
+void pipe_init();
+
+/* a new pipe, fds[0] reads and fds[1] writes */
+int32_t pipe_create(int32_t* fds);
+
+/* another descriptor, or none, refers to the pipe end of fd */
+void pipe_dup(fd_t* fd);
+void pipe_release(fd_t* fd);
+int32_t is_pipe(fd_t* fd);
+
+/* pipe driver */
+int32_t pipe_open(const uint8_t* filename);
+int32_t pipe_read(int32_t fd, uint8_t* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_close(int32_t fd);
+int32_t pipe_no_read(int32_t fd, uint8_t* buf, int32_t nbytes);
+int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif /* _PIPE_H */
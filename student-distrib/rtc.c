@@ -4,9 +4,18 @@
  */
 #include "rtc.h"
 #include "fd_table.h"
+#include "sched.h"
 
-/* Interrupt Happened Flag */
-static volatile uint32_t interrupt_flag; // When interrupt happens this changes to 1
+/* A reader waiting for its next virtual interrupt, lives on its kernel stack */
+typedef struct rtc_sleeper_t {
+	uint32_t deadline; // hardware tick count to wake up at
+	wait_queue_t queue;
+	struct rtc_sleeper_t* next;
+} rtc_sleeper_t;
+
+/* Interrupt Counter */
+static volatile uint32_t interrupt_count; // incremented on every interrupt
+static rtc_sleeper_t* sleepers; // sorted by deadline, earliest first
 // int32_t rtc_fd; // holds the rtc's fd when opened
 /* Keeps track of current time */
 static uint8_t second;
@@ -47,10 +56,11 @@ void rtc_init(void)
 	prev_data = inb(CMOS_RTC_PORT);				// get current values of B
 	outb((DISABLE_NMI | REG_B), SELECT_REG);	// set index again (a read resets the index to register D)
 	outb((prev_data | PERIODIC), CMOS_RTC_PORT);	// turn on bit 6 of reg B
-	set_frequency(DEFAULT_FREQ); // default should be 2Hz
+	set_frequency(RTC_HW_FREQ); // every fd divides this down to its own rate
 
 	// initialize local variables
-	interrupt_flag = 1; // initialize to 1
+	interrupt_count = 0;
+	sleepers = NULL;
 	// rtc_fd = -1; // initialize to no file descriptor in use
 	enable_irq(RTC_IRQ);	// enable PIC to accept interrupts
 	restore_flags(flags);
@@ -79,8 +89,13 @@ void rtc_handler(void)
 	// call terminal's write
 
 	/* Don't touch anything below */
-	// alternate between then numbers so that rtc_read doesn't need to assign
-	interrupt_flag = 1;
+	// only wake the readers whose virtual interrupt is due
+	interrupt_count++;
+	while(sleepers != NULL && (int32_t)(interrupt_count - sleepers->deadline) >= 0)
+	{
+		wake_up(&(sleepers->queue));
+		sleepers = sleepers->next;
+	}
 
 	// Register C needs to be read after an IRQ 8 otherwise IRQ won't happen again
 	outb(REG_C, SELECT_REG);
@@ -134,6 +149,31 @@ void set_frequency(uint32_t frequency)
 	// unlock it
 	restore_flags(flags);
 }
+
+/*
+ * virtual_frequency
+ *		DESCRIPTION:
+ *			Same rules as set_frequency, but only works out the frequency
+ *			without touching the hardware. Powers of two above 1024Hz are
+ *			limited to 1024Hz, anything else becomes 2Hz.
+ *		INPUT: frequency - the frequency asked for
+ *		RETURN VALUE: the frequency a descriptor will run at
+ */
+uint32_t virtual_frequency(uint32_t frequency)
+{
+	uint32_t i;
+	for(i = 0; i < NUM_FREQ; i++)
+		if(frequency == frequencies[i]) // find the frequency
+			break;
+
+	if(i == NUM_FREQ)
+		return DEFAULT_FREQ; // not a power of two we know
+
+	if(frequency > RTC_HW_FREQ)
+		return RTC_HW_FREQ; // can't go faster than the hardware
+
+	return frequency;
+}
 /*********************************************************/
 
 /* JC
@@ -153,9 +193,6 @@ void set_frequency(uint32_t frequency)
  */
 int32_t rtc_open(const uint8_t* blank1)
 {
-	// Upon open it should be frequency 2Hz
-	set_frequency(2);
-
 	int32_t fd_index = get_fd_index(); // get an available index
 	if(fd_index == -1)
 	{
@@ -169,6 +206,10 @@ int32_t rtc_open(const uint8_t* blank1)
 	rtc_fd_info.inode_ptr = -1; // not a normal file
 	rtc_fd_info.file_position = 0;
 	rtc_fd_info.flags = 1;	// in use
+	// Upon open it should be frequency 2Hz, only for this fd
+	rtc_fd_info.rtc_freq = DEFAULT_FREQ;
+	rtc_fd_info.rtc_ticks = interrupt_count;
+	rtc_fd_info.pipe = NULL;
 	set_fd_info(fd_index, rtc_fd_info);
 
 	return fd_index;
@@ -177,36 +218,69 @@ int32_t rtc_open(const uint8_t* blank1)
 /* JC
  * rtc_read
  * 	DESCRIPTION:
- *			Returns once the next RTC interrupt occurs.
- *		INPUT: none
+ *			Returns once the next virtual interrupt of this fd occurs. The hardware
+ *			runs at RTC_HW_FREQ, the fd gets an interrupt every RTC_HW_FREQ/rtc_freq
+ *			hardware ticks. The process sleeps until then instead of spinning.
+ *		INPUT: fd - the rtc's file descriptor
  *		OUTPUT: none
- *		RETURN VALUE: 0 - always
+ *		RETURN VALUE: 0 - success
+ *						 -1 - not an rtc descriptor
  *		SIDE_EFFECTS: none
  */
 int32_t rtc_read(int32_t fd, uint8_t* blank1, int32_t blank2)
 {
-	interrupt_flag = 0;
-	// wait for interrupt to happen
-	while(!interrupt_flag);
+	uint32_t flags;
+	uint32_t period;
+	rtc_sleeper_t me;
+	rtc_sleeper_t** spot;
+	fd_t* rtc_fd = get_fd(fd);
+
+	if(rtc_fd == NULL || rtc_fd->rtc_freq == 0)
+		return -1;
+
+	// check the count with interrupts off so the wake up can't be missed
+	cli_and_save(flags);
+	period = RTC_HW_FREQ / rtc_fd->rtc_freq;
+	// next multiple of the period since the last virtual interrupt, skip any we missed
+	me.deadline = interrupt_count + period - ((interrupt_count - rtc_fd->rtc_ticks) % period);
+	wait_queue_init(&(me.queue));
+
+	// keep the list sorted so the handler only ever looks at the front
+	for(spot = &sleepers; *spot != NULL && (int32_t)((*spot)->deadline - me.deadline) <= 0; spot = &((*spot)->next));
+	me.next = *spot;
+	*spot = &me;
+
+	// the handler unlinks us before waking us up
+	while((int32_t)(interrupt_count - me.deadline) < 0)
+		sleep_on(&(me.queue));
+
+	rtc_fd->rtc_ticks = me.deadline;
+	restore_flags(flags);
 	return 0;
 }
 
 /* JC
  * rtc_write
  * 	DESCRIPTION:
- *			Given a pointer to a frequency, change the frequency of the RTC driver.
+ *			Given a pointer to a frequency, change the virtual frequency of this fd.
+ *			The hardware isn't reprogrammed, other fds keep their own rates.
  *		INPUT:
  *			fd - the file descriptor that contains rtc
  *			buf - a pointer to a 4 byte frequency
  *		OUTPUT: none
  *		RETURN VALUE:
  *			 0 - successful change
- *		SIDE_EFFECTS: modifies RTC frequency
+ *			-1 - bad fd or buffer
+ *		SIDE_EFFECTS: modifies the fd's RTC frequency
  */
 int32_t rtc_write(int32_t fd, const void* buf, int32_t blank1)
 {
+	fd_t* rtc_fd = get_fd(fd);
+	if(rtc_fd == NULL || buf == NULL)
+		return -1;
+
 	uint32_t* speed = (uint32_t*)buf; // change into meaningful data
-	set_frequency(*speed);
+	rtc_fd->rtc_freq = virtual_frequency(*speed);
 	return 0;
 }
 
@@ -77,6 +77,7 @@
 #define SHIFT4				16
 
 #define DEFAULT_FREQ		2 	// 2Hz = 2 interrupts/second
+#define RTC_HW_FREQ		1024	// the hardware always runs this fast, fds get virtual rates
 #define MAX_RATE			6		// 1024Hz
 #define MIN_RATE			15
 #define NUM_FREQ			14
@@ -94,6 +95,7 @@ int32_t rtc_write(int32_t fd, const void* buf, int32_t blank1);
 int32_t rtc_close(int32_t fd);
 
 void set_frequency(uint32_t frequency);
+uint32_t virtual_frequency(uint32_t frequency);
 
 /* Additional Functionalities */
 /* Following 4 functions are used to
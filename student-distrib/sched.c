@@ -1,7 +1,13 @@
 /*
- * sched.c -
+ * sched.c - Round robin scheduler driven by the PIT.
  *
+ *		Every process that is able to run sits in the run queue. Each PIT
+ *		interrupt counts down the quantum of the running process, once it is
+ *		used up the next process in the queue gets the CPU. Every process has
+ *		its own 8KB kernel stack, switching processes is switching stacks.
  *
+ *		A process waiting for an event sleeps on a wait queue, it is off the
+ *		run queue until the event's handler wakes it up.
  */
 
 #include "i8259.h"
@@ -10,10 +16,19 @@
 #include "paging.h"
 #include "terminal.h"
 #include "idt.h"
+#include "wrapper.h"
+#include "trace.h"
 
-// static int init_flag;
+#define CALLEE_SAVED 4 // registers context_switch pushes
 
-/* 
+static int32_t run_queue[MAX_PROCESSES]; // pids that are ready to run
+static uint32_t run_count;
+static uint32_t quantum;	// ticks in a time slice
+static uint32_t ticks_left;	// ticks left in the current time slice
+static volatile uint32_t idling; // everyone is asleep, waiting for an interrupt
+static int32_t exited = -1; // stopped for good, freed once we're off its stack
+
+/*
  *	pit_init
  *		DESCRIPTION:
  *			Set the entry for PIT, and set the time slice.
@@ -32,17 +47,20 @@ void pit_init()
 	SET_IDT_ENTRY(idt[PIT_VECTOR_NUM], pit_handler_wrapper);
 
 	// get the proper output info
-	uint16_t output = MAX_PIT_FREQ/TIME_SLICE;
+	uint16_t output = MAX_PIT_FREQ/PIT_HZ;
 	uint8_t lower = output & LOW_BYTE;
 	uint8_t higher = output >> 8;
 
 	// initialize the ports
-	// set the divisor to every 30
+	// interrupt PIT_HZ times a second
+	outb(PIT_MODE3, PIT_CMD);
 	outb(lower, CHANNEL0);
 	outb(higher, CHANNEL0);
 
-	// sched_proc = 0;
-	// init_flag = 1;
+	pit_ticks = 0;
+	run_count = 0;
+	quantum = DEFAULT_QUANTUM;
+	ticks_left = DEFAULT_QUANTUM;
 
 	// unlock
 	enable_irq(PIT_IRQ); // enable IRQ 0
@@ -51,87 +69,312 @@ void pit_init()
 
 /* pit_handler
  *		DESCRIPTION:
- *			Handles the PIT interrupt, during the interrupt, it should
- *			switch the process that is running, by giving the other program a time slice
+ *			Handles the PIT interrupt, once the running process has used up its
+ *			time slice, give the CPU to the next process in the run queue.
+ *			Every ALARM_TICKS the process in the terminal on screen gets ALARM.
  *		INPUT: none
  *		OUTPUT: none
  *		RETURN VALUE: none
  */
 void pit_handler()
 {
-	// int32_t p_id = current_process[sched_proc];
-
-	// if (p_id > 7){
-	// 	send_eoi(PIT_IRQ);
-	// 	return;
-	// }
-
-	// if(init_flag){
-	// 	init_flag = 0;
-	// 	in_use[curr_terminal] = 0;
-	// 	send_eoi(PIT_IRQ);
-	// 	execute((uint8_t*)"shell");
-	// }
-
-	// /* store esp and ebp for old process */
-	// asm volatile(
-	// 	"movl %%esp, %0 \n"
-	// 	: "=r" (proc_ESP[p_id])
-	// );
-	// asm volatile(
-	// 	"movl %%ebp, %0 \n"
-	// 	: "=r" (proc_EBP[p_id])
-	// );
-
-	// /* get new process */
-	// sched_proc = (sched_proc+1)%3;
-	// p_id = current_process[sched_proc];
-
-	// if (p_id > 7){
-	// 	send_eoi(PIT_IRQ);
-	// 	return;
-	// }
-
-	// if(p_id < 0 && (curr_terminal == sched_proc)){
-	// 	in_use[curr_terminal] = 0;
-	// 	send_eoi(PIT_IRQ);
-	// 	execute((uint8_t*)"shell");
-	// }
-	// else{
-	// 	sched_proc = curr_terminal;
-	// 	send_eoi(PIT_IRQ);
-	// 	return;
-	// }
-
-	// /* read file into memory */
-	// uint8_t *file_name = process_array[p_id]->comm;
-	// dentry_t dentry;
-	// uint32_t address = PROGRAM_START;
-	// read_dentry_by_name((uint8_t*) file_name, &dentry);
-	// read_data(dentry.inode_idx, 0, (uint8_t *)address, inodes[dentry.inode_idx].file_size);
-
-	// /* set up paging */
-	// add_process(p_id);
-
- //   /* prepare tss for context switch */
-	// tss.esp0 = K_STACK_BOTTOM - PROCESS_SIZE * (p_id) - BYTE_SIZE/2;
- // 	tss.ss0 = KERNEL_DS;
-
-	send_eoi(PIT_IRQ); // wait till the switch is done before continuing work
-
-	// /* restore esp and ebp for return */
-	// asm volatile(
-	// 	"movl %0, %%esp \n"
-	// 	:
-	// 	: "r"(proc_ESP[p_id])
-	// );
-	// asm volatile(
-	// 	"movl %0, %%ebp \n"
-	// 	:
-	// 	: "r"(proc_EBP[p_id])
-	// );
+	pit_ticks++;
+	send_eoi(PIT_IRQ); // the next process won't come back through here to send it
+
+	if(pit_ticks % ALARM_TICKS == 0)
+		signal_send(current_process[curr_terminal], ALARM);
+
+	if(--ticks_left > 0)
+		return; // still has time left
+
+	ticks_left = quantum;
+	schedule();
 }
 
+/*
+ * set_quantum
+ *		DESCRIPTION:
+ *			Changes how many PIT ticks a process gets before it is switched out.
+ *		INPUT: ticks - length of a time slice, each tick is 1/PIT_HZ seconds
+ *		RETURN VALUE: 0 - success, -1 - out of range
+ */
+int32_t set_quantum(uint32_t ticks)
+{
+	if(ticks == 0 || ticks > MAX_QUANTUM)
+		return -1;
+
+	quantum = ticks;
+	return 0;
+}
+
+/*
+ * sched_enqueue
+ *		DESCRIPTION:
+ *			Puts a process at the end of the run queue. A process is only
+ *			queued once.
+ *		INPUT: pid - the process that is ready to run
+ *		RETURN VALUE: none
+ */
+void sched_enqueue(int32_t pid)
+{
+	uint32_t flags;
+	uint32_t i;
+	cli_and_save(flags);
+
+	for(i = 0; i < run_count; i++)
+		if(run_queue[i] == pid)
+			break; // already queued
+
+	if(pid >= 0 && i == run_count && run_count < MAX_PROCESSES)
+		run_queue[run_count++] = pid;
 
+	restore_flags(flags);
+}
 
+/*
+ * sched_dequeue
+ *		DESCRIPTION:
+ *			Takes a process off the run queue, it won't get the CPU until
+ *			it's enqueued again.
+ *		INPUT: pid - the process to remove
+ *		RETURN VALUE: none
+ */
+void sched_dequeue(int32_t pid)
+{
+	uint32_t flags;
+	uint32_t i;
+	cli_and_save(flags);
 
+	for(i = 0; i < run_count; i++)
+	{
+		if(run_queue[i] == pid)
+		{
+			// keep the order of everyone behind it
+			for(; i + 1 < run_count; i++)
+				run_queue[i] = run_queue[i+1];
+			run_count--;
+			break;
+		}
+	}
+
+	restore_flags(flags);
+}
+
+/*
+ * launch_shell - helper
+ *		DESCRIPTION:
+ *			First thing a terminal runs. Starts the base shell on the terminal's
+ *			own kernel stack, never returns.
+ */
+static void launch_shell()
+{
+	execute((uint8_t*)"shell"); // gets the terminal's pid, it has no process yet
+}
+
+/*
+ * reap - helper
+ *		DESCRIPTION: Frees the process that exited, unless it is still the one running.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ */
+static void reap()
+{
+	if(exited != -1 && exited != current_process[sched_terminal])
+	{
+		process_free(exited);
+		exited = -1;
+	}
+}
+
+/*
+ * live_process - helper
+ *		DESCRIPTION:
+ *			Picks the process that stands for a terminal once the one that did
+ *			exits: its parent if that is still on the terminal, otherwise any
+ *			other process there.
+ *		INPUT: terminal - the terminal
+ *				 pid - the process that exits
+ *		RETURN VALUE: the pid, -1 if the terminal has nobody else
+ */
+static int32_t live_process(uint32_t terminal, int32_t pid)
+{
+	int32_t parent = process_array[pid]->parent_id;
+	int32_t i;
+
+	if(parent >= 0 && parent < MAX_PROCESSES && process_array[parent] != NULL &&
+	   process_array[parent]->terminal == terminal)
+		return parent;
+
+	for(i = 0; i < MAX_PROCESSES; i++)
+		if(i != pid && process_array[i] != NULL && process_array[i]->terminal == terminal)
+			return i;
+
+	return -1;
+}
+
+/*
+ * switch_from - helper
+ *		DESCRIPTION:
+ *			Saves the kernel stack of prev and resumes the next process in the
+ *			run queue. Terminals that don't have a shell yet get one started
+ *			first. Returns when prev is picked again.
+ *		INPUT: prev - the process on the CPU
+ *		RETURN VALUE: none
+ */
+static void switch_from(int32_t prev)
+{
+	uint32_t flags;
+	uint32_t i, t;
+	int32_t next;
+	cli_and_save(flags);
+
+	if(prev < 0 || idling)
+	{	// still booting, or already in the idle loop below
+		restore_flags(flags);
+		return;
+	}
+
+	// start the base shell of any terminal that doesn't have one
+	for(t = 0; t < MAX_TERMINAL; t++)
+	{
+		if(current_process[t] == -1 && process_alloc(t) == 0)
+		{
+			// build a stack that context_switch will "return" into launch_shell from
+			uint32_t* frame = (uint32_t*)KERNEL_STACK_TOP(t);
+			*(--frame) = (uint32_t)launch_shell;
+			for(i = 0; i < CALLEE_SAVED; i++)
+				*(--frame) = 0;
+
+			sched_terminal = t;
+			vid_terminal = t;
+			context_switch(&(process_array[prev]->sched_esp), (uint32_t)frame);
+			restore_flags(flags);
+			return;
+		}
+	}
+
+	// everyone is asleep, wait for an interrupt to wake someone up
+	while(run_count == 0)
+	{
+		idling = 1;
+		asm volatile("sti; hlt; cli");
+		idling = 0;
+	}
+
+	// round robin, take the process after the running one
+	for(i = 0; i < run_count; i++)
+		if(run_queue[i] == prev)
+			break;
+	next = (i < run_count) ? run_queue[(i+1) % run_count] : run_queue[0];
+
+	if(next == prev)
+	{
+		restore_flags(flags);
+		return; // nobody else wants the CPU
+	}
+
+	sched_terminal = process_array[next]->terminal;
+	vid_terminal = sched_terminal;
+	current_process[sched_terminal] = next; // a terminal can have more than one process running
+
+	/* set up paging */
+	add_process(next);
+
+	/* prepare tss for context switch */
+	tss.esp0 = KERNEL_STACK_TOP(next);
+	tss.ss0 = KERNEL_DS;
+
+	ticks_left = quantum; // a full time slice, even if prev went to sleep early
+	TRACE(TRACE_SWITCH, next);
+	context_switch(&(process_array[prev]->sched_esp), process_array[next]->sched_esp);
+
+	// we are back on our own stack
+	reap();
+	restore_flags(flags);
+}
+
+/*
+ * schedule
+ *		DESCRIPTION:
+ *			Gives the CPU to the next process in the run queue. Returns when the
+ *			calling process is picked again.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ */
+void schedule()
+{
+	switch_from(current_process[sched_terminal]);
+}
+
+/*
+ * sched_exit
+ *		DESCRIPTION:
+ *			Takes the running process off the CPU for good. It can't free the
+ *			kernel stack it is running on, the next process to run frees it.
+ *			The terminal is handed to another of its processes first, so the
+ *			PIT's ALARM doesn't go to a pid that is freed or reused.
+ *		INPUT: none
+ *		RETURN VALUE: none, never returns
+ */
+void sched_exit()
+{
+	cli();
+	reap(); // whoever exited before us
+	exited = current_process[sched_terminal];
+	sched_dequeue(exited);
+	current_process[sched_terminal] = live_process(sched_terminal, exited);
+	switch_from(exited);
+}
+
+/*
+ * wait_queue_init
+ *		DESCRIPTION: Starts a wait queue with nobody in it.
+ *		INPUT: queue - the queue to initialize
+ *		RETURN VALUE: none
+ */
+void wait_queue_init(wait_queue_t* queue)
+{
+	queue->head = NULL;
+}
+
+/*
+ * sleep_on
+ *		DESCRIPTION:
+ *			Puts the running process to sleep on the queue and gives up the CPU.
+ *			Returns after wake_up was called on the queue. The caller has to
+ *			disable interrupts before checking the condition it waits for, and
+ *			check it again after waking up, otherwise the wake up can be missed.
+ *		INPUT: queue - the queue to sleep on
+ *		RETURN VALUE: none
+ */
+void sleep_on(wait_queue_t* queue)
+{
+	wait_node_t node;
+	node.pid = current_process[sched_terminal];
+	node.next = queue->head;
+	queue->head = &node;
+
+	sched_dequeue(node.pid);
+	schedule(); // wake_up takes the node off the queue
+}
+
+/*
+ * wake_up
+ *		DESCRIPTION:
+ *			Makes every process sleeping on the queue runnable again.
+ *			Safe to call from interrupt handlers.
+ *		INPUT: queue - the queue to wake
+ *		RETURN VALUE: none
+ */
+void wake_up(wait_queue_t* queue)
+{
+	uint32_t flags;
+	wait_node_t* node;
+	cli_and_save(flags);
+
+	for(node = queue->head; node != NULL; node = node->next)
+		sched_enqueue(node->pid);
+	queue->head = NULL;
+
+	restore_flags(flags);
+}
@@ -11,17 +11,50 @@
 #include "syscall.h"
 
 #define PIT_IRQ 0
-#define TIME_SLICE 30	// ms = Hz
+#define PIT_HZ 100		// timer interrupts per second, 10ms a tick
+#define DEFAULT_QUANTUM 3	// ticks in a time slice, 30ms
+#define MAX_QUANTUM 100	// one second
 #define MAX_PIT_FREQ 1193182
 #define LOW_BYTE 0x00FF
 
 // ports
 #define CHANNEL0	0x40
+#define PIT_CMD	0x43
+#define PIT_MODE3	0x36	// channel 0, lobyte/hibyte, square wave
+
+/* a sleeping process, lives on the sleeper's kernel stack */
+typedef struct wait_node_t {
+	int32_t pid;
+	struct wait_node_t* next;
+} wait_node_t;
+
+/* processes waiting for the same event */
+typedef struct wait_queue_t {
+	wait_node_t* head;
+} wait_queue_t;
+
+/* number of PIT interrupts since boot */
+volatile uint32_t pit_ticks;
 
 void pit_init();
 void pit_handler();
 
+/* run queue */
+void sched_enqueue(int32_t pid);
+void sched_dequeue(int32_t pid);
 
-#endif /* SCHED_H */
+/* picks the next runnable process and switches to it */
+void schedule();
 
+/* the running process stops for good, never returns */
+void sched_exit();
 
+/* changes the time slice, in PIT ticks up to MAX_QUANTUM, ctrl+8 cycles it */
+int32_t set_quantum(uint32_t ticks);
+
+/* wait queues, sleep_on must be called with interrupts off */
+void wait_queue_init(wait_queue_t* queue);
+void sleep_on(wait_queue_t* queue);
+void wake_up(wait_queue_t* queue);
+
+#endif /* SCHED_H */
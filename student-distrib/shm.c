@@ -0,0 +1,149 @@
+/*
+ * shm.c - Shared memory segments.
+ *
+ *		A segment is a set of zeroed frames with a name. Every process that
+ *		maps it gets the same frames in its file mapping window, writable, so
+ *		what one process writes the others see without a system call. Frames
+ *		count their references, the segment's own and one per mapping. Once
+ *		nobody maps the first page anymore the segment is gone, pages that are
+ *		still mapped somewhere go with their last mapping.
+ */
+
+#include "shm.h"
+#include "paging.h"
+#include "frame.h"
+#include "kmalloc.h"
+#include "syscall.h"
+#include "terminal.h"
+
+static shm_segment_t segments[MAX_SEGMENTS]; // pages == 0 marks an unused entry
+
+/*
+ * destroy_segment - helper
+ *		DESCRIPTION: Drops the segment's references to its frames and frees the entry.
+ *		INPUT: seg - the segment
+ *		RETURN VALUE: none
+ */
+static void destroy_segment(shm_segment_t* seg)
+{
+	uint32_t i;
+
+	for(i = 0; i < seg->pages; i++)
+		free_frame(seg->frames[i]);
+	kfree(seg->frames);
+	seg->pages = 0;
+}
+
+/*
+ * create_segment - helper
+ *		DESCRIPTION: Makes a segment of zeroed frames.
+ *		INPUT: seg - an unused entry
+ *				 name - the segment's name
+ *				 pages - how many 4kb pages
+ *		RETURN VALUE: 0 - success, -1 - out of memory
+ */
+static int32_t create_segment(shm_segment_t* seg, const int8_t* name, uint32_t pages)
+{
+	int32_t frame;
+
+	if((seg->frames = kmalloc(pages * sizeof(uint32_t))) == NULL)
+		return -1;
+
+	for(seg->pages = 0; seg->pages < pages; seg->pages++)
+	{
+		if((frame = alloc_frame()) == -1)
+		{
+			destroy_segment(seg);
+			return -1;
+		}
+		clear_frame(frame);
+		seg->frames[seg->pages] = frame;
+	}
+
+	strncpy(seg->name, name, SHM_NAME_LENGTH);
+	return 0;
+}
+
+/*
+ * shm_map
+ *		DESCRIPTION:
+ *			Maps the segment called name in the running process. If there is no
+ *			such segment one of nbytes is made, otherwise nbytes only has to fit
+ *			in it.
+ *		INPUT: name - up to SHM_NAME_LENGTH-1 characters
+ *				 nbytes - size the caller needs
+ *				 start - set to where the segment is mapped
+ *		RETURN VALUE: size of the segment in bytes, -1 if it's too small, there is
+ *						  no room in the window, or memory is used up
+ */
+int32_t shm_map(const int8_t* name, uint32_t nbytes, uint8_t** start)
+{
+	uint32_t flags;
+	uint32_t i, page;
+	int32_t pid = current_process[sched_terminal];
+	int32_t virt;
+	shm_segment_t* seg = NULL;
+	shm_segment_t* unused = NULL;
+
+	cli_and_save(flags);
+	for(i = 0; i < MAX_SEGMENTS; i++)
+	{
+		if(segments[i].pages == 0)
+		{
+			if(unused == NULL)
+				unused = &segments[i];
+		}
+		else if(strncmp(segments[i].name, name, SHM_NAME_LENGTH) == 0)
+		{
+			seg = &segments[i];
+			break;
+		}
+	}
+
+	if(seg == NULL)
+	{
+		uint32_t pages = (nbytes + FRAME_SIZE - 1) / FRAME_SIZE;
+		if(unused == NULL || pages == 0 || pages > SHM_MAX_PAGES
+				|| create_segment(unused, name, pages) == -1)
+		{
+			restore_flags(flags);
+			return -1;
+		}
+		seg = unused;
+	}
+
+	if(nbytes > seg->pages * FRAME_SIZE || (virt = find_map_pages(pid, seg->pages)) == -1)
+	{
+		restore_flags(flags);
+		shm_reap(); // it may have just been made
+		return -1;
+	}
+
+	for(page = 0; page < seg->pages; page++)
+		map_shared_page(pid, virt + page*FRAME_SIZE, seg->frames[page]);
+
+	restore_flags(flags);
+	*start = (uint8_t*)virt;
+	return seg->pages * FRAME_SIZE;
+}
+
+/*
+ * shm_reap
+ *		DESCRIPTION:
+ *			Frees every segment whose first page only the segment itself still
+ *			refers to. Called whenever pages of the file mapping window go away.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ */
+void shm_reap()
+{
+	uint32_t flags;
+	uint32_t i;
+	cli_and_save(flags);
+
+	for(i = 0; i < MAX_SEGMENTS; i++)
+		if(segments[i].pages != 0 && frame_references(segments[i].frames[0]) == 1)
+			destroy_segment(&segments[i]);
+
+	restore_flags(flags);
+}
@@ -0,0 +1,28 @@
+/*
+ * shm.h - Declarations for shared memory segments.
+ *
+ */
+
+#ifndef _SHM_H
+#define _SHM_H
+
+#include "lib.h"
+
+#define MAX_SEGMENTS    16
+#define SHM_NAME_LENGTH 32
+#define SHM_MAX_PAGES   256 // 1MB, a quarter of the file mapping window
+
+/* named pages any process can map, the segment holds a reference to every frame */
+typedef struct shm_segment_t {
+	int8_t name[SHM_NAME_LENGTH];
+	uint32_t pages;		// 0 marks an unused entry
+	uint32_t* frames;		// one per page, from kmalloc
+} shm_segment_t;
+
+/* maps a segment in the running process, making it first if nobody has */
+int32_t shm_map(const int8_t* name, uint32_t nbytes, uint8_t** start);
+
+/* frees the segments no process maps anymore */
+void shm_reap();
+
+#endif /* _SHM_H */
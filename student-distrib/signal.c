@@ -0,0 +1,179 @@
+/*
+ * signal.c - Signals sent to user programs.
+ *
+ *		A signal is a bit in the pending set of a process. Exceptions the
+ *		program causes and the timer's alarm set it, nothing happens until the
+ *		process is on its way back to user mode. Then the lowest pending signal
+ *		either gets its default action, or the program's handler is called: the
+ *		saved registers and a few bytes of code that call sigreturn go on the
+ *		user stack, and the program resumes in the handler with the signal
+ *		number as its argument. Other signals are blocked until sigreturn puts
+ *		the registers back.
+ */
+
+#include "signal.h"
+#include "syscall.h"
+#include "terminal.h"
+
+#define SIGRETURN_CODE_SIZE 8			// the code below, padded to a multiple of 4
+#define USER_FLAGS  0x00000CD5			// CF, PF, AF, ZF, SF, DF and OF, a program can change them
+#define FAULT_SIGNALS ((1 << DIV_ZERO) | (1 << SEGFAULT))
+#define KILLED_STATUS 255				// halt adds 1 for a process killed by an exception
+
+/* what a handler returns into, calls sigreturn */
+static const uint8_t sigreturn_code[SIGRETURN_CODE_SIZE] = {
+	0xB8, SIGRETURN_NUM, 0x00, 0x00, 0x00,	// movl $SIGRETURN_NUM, %eax
+	0xCD, 0x80,								// int $0x80
+	0x90									// nop
+};
+
+/*
+ * signal_kill - helper
+ *		DESCRIPTION: The default action of DIV_ZERO, SEGFAULT and INTERRUPT.
+ *		INPUT: none
+ *		RETURN VALUE: doesn't return, the running process is halted
+ */
+static void signal_kill()
+{
+	exception_flag = 1;
+	halt(KILLED_STATUS);
+}
+
+/*
+ * next_signal - helper
+ *		DESCRIPTION: Takes the lowest pending signal that isn't blocked.
+ *		INPUT: process - the running process
+ *		RETURN VALUE: the signal number, -1 if there is none
+ */
+static int32_t next_signal(pcb* process)
+{
+	uint32_t flags;
+	uint32_t ready;
+	int32_t signum;
+	cli_and_save(flags);
+
+	ready = process->pending_signals & ~process->blocked_signals;
+	if(ready == 0)
+	{
+		restore_flags(flags);
+		return -1;
+	}
+
+	for(signum = 0; !(ready & (1 << signum)); signum++)
+		;
+	process->pending_signals &= ~(1 << signum);
+
+	restore_flags(flags);
+	return signum;
+}
+
+/*
+ * signal_send
+ *		DESCRIPTION: Marks a signal pending, a signal that is pending already is only handled once.
+ *		INPUT: pid - the process that gets it
+ *				 signum - the signal
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: safe to call from interrupt handlers
+ */
+void signal_send(int32_t pid, int32_t signum)
+{
+	uint32_t flags;
+
+	if(pid < 0 || pid >= MAX_PROCESSES || signum < 0 || signum >= NUM_SIGNALS)
+		return;
+
+	cli_and_save(flags);
+	if(process_array[pid] != NULL)
+		process_array[pid]->pending_signals |= 1 << signum;
+	restore_flags(flags);
+}
+
+/*
+ * signal_deliver
+ *		DESCRIPTION:
+ *			Handles the pending signals of the running process before it goes
+ *			back to user mode. Ignored ones are dropped, the first one with a
+ *			handler gets a frame on the user stack:
+ *				return address - the sigreturn code further up
+ *				signal number  - the handler's argument
+ *				hw_context_t   - the registers sigreturn puts back
+ *				sigreturn code
+ *			A fault that comes while its signal is blocked can't be handled,
+ *			running the instruction again would fault forever.
+ *		INPUT: regs - the registers saved on the way into the kernel
+ *		RETURN VALUE: 1 - regs now start the handler, 0 - regs weren't changed
+ *		SIDE EFFECTS: may halt the process
+ */
+int32_t signal_deliver(hw_context_t* regs)
+{
+	int32_t pid = current_process[sched_terminal];
+	pcb* process;
+	int32_t signum;
+	uint32_t code, frame;
+
+	if(pid < 0 || (process = process_array[pid]) == NULL)
+		return 0;
+
+	if(process->pending_signals & process->blocked_signals & FAULT_SIGNALS)
+		signal_kill();
+
+	while((signum = next_signal(process)) != -1)
+	{
+		if(process->signal_handlers[signum] != NULL)
+			break;
+		if(signum != ALARM && signum != USER1)
+			signal_kill(); // the rest are ignored
+	}
+	if(signum == -1)
+		return 0;
+
+	code = regs->esp - SIGRETURN_CODE_SIZE;
+	frame = code - sizeof(hw_context_t) - 2 * sizeof(uint32_t);
+	if(bad_userspace_addr((void*)frame, regs->esp - frame, 1))
+		signal_kill(); // no stack to run the handler on
+
+	memcpy((void*)code, sigreturn_code, SIGRETURN_CODE_SIZE);
+	memcpy((void*)(frame + 2 * sizeof(uint32_t)), regs, sizeof(hw_context_t));
+	((uint32_t*)frame)[0] = code;
+	((uint32_t*)frame)[1] = signum;
+
+	regs->esp = frame;
+	regs->eip = (uint32_t)process->signal_handlers[signum];
+	process->blocked_signals = ALL_SIGNALS;
+	return 1;
+}
+
+/*
+ * signal_return
+ *		DESCRIPTION:
+ *			Copies the registers saved by signal_deliver back into the frame the
+ *			process returns to user mode with. The handler returned into the
+ *			sigreturn code, popping the return address, so the saved registers
+ *			are just past the signal number. Segments and the flags a program
+ *			can't set itself are kept.
+ *		INPUT: regs - the registers saved on the way into sigreturn
+ *		RETURN VALUE: the restored eax, -1 if the saved registers aren't in the program
+ *		SIDE EFFECTS: unblocks every signal
+ */
+int32_t signal_return(hw_context_t* regs)
+{
+	pcb* process = process_array[current_process[sched_terminal]];
+	hw_context_t* saved = (hw_context_t*)(regs->esp + sizeof(uint32_t));
+
+	if(bad_userspace_addr(saved, sizeof(hw_context_t), 0))
+		return -1;
+
+	regs->ebx = saved->ebx;
+	regs->ecx = saved->ecx;
+	regs->edx = saved->edx;
+	regs->esi = saved->esi;
+	regs->edi = saved->edi;
+	regs->ebp = saved->ebp;
+	regs->eax = saved->eax;
+	regs->eip = saved->eip;
+	regs->esp = saved->esp;
+	regs->eflags = (regs->eflags & ~USER_FLAGS) | (saved->eflags & USER_FLAGS);
+
+	process->blocked_signals = 0;
+	return regs->eax;
+}
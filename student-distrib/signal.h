@@ -0,0 +1,55 @@
+/*
+ * signal.h - Declarations for signals sent to user programs.
+ *
+ */
+
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#include "lib.h"
+
+/* the signal numbers, same as the user side's enum signums */
+#define DIV_ZERO    0
+#define SEGFAULT    1
+#define INTERRUPT   2
+#define ALARM       3
+#define USER1       4
+#define NUM_SIGNALS 5
+
+#define ALL_SIGNALS  ((1 << NUM_SIGNALS) - 1)
+#define ALARM_TICKS  1000 // PIT ticks between alarms, 10 seconds
+#define SIGRETURN_NUM 10  // system call number of sigreturn
+
+/* registers saved on the kernel stack by every way into the kernel from a
+ * program, in the order wrapper.S pushes them, lowest address first */
+typedef struct hw_context_t {
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+	uint32_t esi;
+	uint32_t edi;
+	uint32_t ebp;
+	uint32_t eax;
+	uint32_t ds;
+	uint32_t es;
+	uint32_t fs;
+	uint32_t irq_exc;		// vector, irq or system call number
+	uint32_t error_code;	// 0 if the processor didn't push one
+	uint32_t eip;			// the rest is pushed by the processor
+	uint32_t cs;
+	uint32_t eflags;
+	uint32_t esp;			// only there when coming from user mode
+	uint32_t ss;
+} hw_context_t;
+
+/* marks a signal pending for a process */
+void signal_send(int32_t pid, int32_t signum);
+
+/* on the way back to user mode, runs the default action of a pending signal
+ * or sets up its handler, returns 1 if the frame has to go back through iret */
+int32_t signal_deliver(hw_context_t* regs);
+
+/* restores the registers a handler's frame saved, returns the restored eax */
+int32_t signal_return(hw_context_t* regs);
+
+#endif /* _SIGNAL_H */
@@ -8,16 +8,45 @@
 #include "wrapper.h"
 #include "filesystem.h"
 #include "terminal.h"
+#include "sched.h"
+#include "frame.h"
+#include "kmalloc.h"
+#include "pipe.h"
+#include "shm.h"
+#include "futex.h"
+#include "trace.h"
 
 #define STATUS_BYTEMASK    0x000000FF
 #define FILE_NAME_LENGTH   32
-#define BYTES_TO_READ      28
 #define ENTRY_POINT_START  24
 #define MAGIC_NUMBER_SIZE	4
 
+// the parts of the ELF header execute uses to size the program
+#define ELF_HEADER_SIZE		52
+#define PHOFF_START			28
+#define PHNUM_START			44
+#define PHDR_WORDS			8	// a program header is 8 words
+#define PH_TYPE				0
+#define PH_VADDR				2
+#define PH_MEMSZ				5
+#define PT_LOAD				1
+#define MAX_PHDRS				16
+
+#define USER_STACK_TOP		(PROGRAM_PAGE + USER_PAGE_SIZE)
+#define USER_STACK_PAGES	8	// 32KB of stack below the user esp
+#define USER_STACK_BOTTOM	(USER_STACK_TOP - USER_STACK_PAGES*FRAME_SIZE)
+
+#define KERNEL_STACK_FRAMES	(PROCESS_SIZE / FRAME_SIZE)
+
 static uint8_t magic_numbers[4] = {0x7f, 0x45, 0x4c, 0x46};
 static uint32_t extended_status;
+static int32_t halted_pid; // halt needs it after it left the child's stack
+static int32_t next_free_pid[MAX_PROCESSES]; // free list of pids, linked through this
+static int32_t free_pids; // first free pid, -1 if there's none
+static kmem_cache_t* pcb_cache;
+static kmem_cache_t* fd_cache; // a whole fd table per object
 static int8_t cmd_args[MAX_TERMINAL][TERM_BUFF_SIZE];
+static exec_info_t exec_cache[EXEC_CACHE_SIZE]; // indexed by inode, the file system never changes
 // holds command argument, needs this because process hasn't been created when this is parsed
 
 /* NM
@@ -30,16 +59,306 @@ static int8_t cmd_args[MAX_TERMINAL][TERM_BUFF_SIZE];
 void pc_init(){
 	uint32_t cnt;
 	curr_terminal = 0; // initialize to the first terminal
+	sched_terminal = 0; // the first shell runs in the first terminal
+	vid_terminal = 0;
 	// initialize all the terminal data
 	for(cnt = 0; cnt < MAX_TERMINAL; cnt++)
 		current_process[cnt] = -1;
 
 	// initialize all the processes
 	for(cnt = 0; cnt < MAX_PROCESSES; cnt++)
-	{
 		process_array[cnt] = NULL;
-		in_use[cnt] = 0;
+	pcb_cache = kmem_cache_create("pcb", sizeof(pcb));
+	fd_cache = kmem_cache_create("fd table", sizeof(fd_t) * FD_TABLE_SIZE);
+	exec_cache_flush();
+
+	// the first pids belong to the terminals' base shells, the rest are free
+	free_pids = -1;
+	for(cnt = MAX_PROCESSES; cnt-- > MAX_TERMINAL; )
+	{
+		next_free_pid[cnt] = free_pids;
+		free_pids = cnt;
+	}
+}
+
+/*
+ * alloc_pid - helper
+ *		DESCRIPTION: Takes a pid off the free list.
+ *		INPUT: none
+ *		RETURN VALUE: the pid, -1 if every pid is taken
+ */
+static int32_t alloc_pid()
+{
+	uint32_t flags;
+	int32_t pid;
+	cli_and_save(flags);
+
+	pid = free_pids;
+	if(pid != -1)
+		free_pids = next_free_pid[pid];
+
+	restore_flags(flags);
+	return pid;
+}
+
+/*
+ * free_pid - helper
+ *		DESCRIPTION: Puts a pid back on the free list, the base shells' pids never go there.
+ *		INPUT: pid - the pid to give back
+ *		RETURN VALUE: none
+ */
+static void free_pid(int32_t pid)
+{
+	uint32_t flags;
+	cli_and_save(flags);
+
+	if(pid >= MAX_TERMINAL)
+	{
+		next_free_pid[pid] = free_pids;
+		free_pids = pid;
+	}
+
+	restore_flags(flags);
+}
+
+/*
+ * process_alloc
+ *		DESCRIPTION:
+ *			Gives a pid its pcb and fd table from their caches, its 8KB kernel
+ *			stack and its page tables. A pid that already has them keeps them.
+ *		INPUT: pid - the process
+ *		RETURN VALUE: 0 - success, -1 - out of memory
+ */
+int32_t process_alloc(int32_t pid)
+{
+	pcb* process;
+	fd_t* fds;
+	int32_t stack;
+
+	if(process_array[pid] != NULL)
+		return 0; // a base shell starting over on its own stack
+
+	process = kmem_cache_alloc(pcb_cache);
+	fds = kmem_cache_alloc(fd_cache);
+	stack = alloc_kernel_frames(KERNEL_STACK_FRAMES);
+	if(process != NULL && fds != NULL && stack != -1)
+	{
+		process->kernel_stack = stack;
+		process->fd_table = fds;
+		process_array[pid] = process;
+		if(alloc_page_tables(pid) == 0)
+			return 0;
+		process_array[pid] = NULL;
+	}
+
+	// out of memory, give back whatever we got
+	if(stack != -1)
+		free_kernel_frames(stack, KERNEL_STACK_FRAMES);
+	kmem_cache_free(fds);
+	kmem_cache_free(process);
+	return -1;
+}
+
+/*
+ * process_free
+ *		DESCRIPTION:
+ *			Gives the memory of a process and its pid back. The base shells keep
+ *			theirs, they are always started again on the same stack.
+ *		INPUT: pid - the process, must not be running on its own stack
+ *		RETURN VALUE: none
+ */
+void process_free(int32_t pid)
+{
+	if(pid < MAX_TERMINAL || process_array[pid] == NULL)
+		return;
+
+	free_page_tables(pid);
+	shm_reap(); // the segments only it mapped
+	free_kernel_frames(process_array[pid]->kernel_stack, KERNEL_STACK_FRAMES);
+	kmem_cache_free(process_array[pid]->fd_table);
+	kmem_cache_free(process_array[pid]);
+	process_array[pid] = NULL;
+	free_pid(pid);
+}
+
+/*
+ * image_end - helper
+ *		DESCRIPTION:
+ *			Finds where a program's memory ends. The file is loaded at PROGRAM_START,
+ *			a loadable segment can reach further with its bss.
+ *		INPUT: inode - the program's inode
+ *				 header - the start of the file, header_size bytes of it
+ *		RETURN VALUE: the first address past the program
+ *						  -1 - it runs into the stack
+ */
+static int32_t image_end(uint32_t inode, const uint8_t* header, int32_t header_size)
+{
+	uint32_t phdr[PHDR_WORDS];
+	uint32_t end = PROGRAM_START + inodes[inode].file_size;
+	uint32_t phoff, phnum, i;
+
+	if(header_size == ELF_HEADER_SIZE)
+	{
+		phoff = *(uint32_t*)(header + PHOFF_START);
+		phnum = *(uint16_t*)(header + PHNUM_START);
+
+		for(i = 0; i < phnum && i < MAX_PHDRS; i++)
+		{
+			if(read_data(inode, phoff + i*sizeof(phdr), (uint8_t*)phdr, sizeof(phdr)) != sizeof(phdr))
+				break;
+			if(phdr[PH_TYPE] != PT_LOAD || phdr[PH_VADDR] < PROGRAM_START ||
+				phdr[PH_VADDR] >= USER_STACK_TOP || phdr[PH_MEMSZ] > USER_PAGE_SIZE)
+				continue; // not ours to load
+			if(phdr[PH_VADDR] + phdr[PH_MEMSZ] > end)
+				end = phdr[PH_VADDR] + phdr[PH_MEMSZ];
+		}
+	}
+
+	if(end > USER_STACK_BOTTOM)
+		return -1;
+	return end;
+}
+
+/*
+ * exec_cache_flush
+ *		DESCRIPTION: Forgets every executable execute has seen.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ */
+void exec_cache_flush()
+{
+	uint32_t flags;
+	uint32_t i;
+	cli_and_save(flags);
+
+	for(i = 0; i < EXEC_CACHE_SIZE; i++)
+		exec_cache[i].inode = -1;
+
+	restore_flags(flags);
+}
+
+/*
+ * exec_lookup
+ *		DESCRIPTION:
+ *			Finds a program and what execute needs to know about it. The ELF
+ *			header is only read and checked the first time a program runs, after
+ *			that the answer comes from the cache. A file that isn't executable
+ *			is remembered too.
+ *		INPUT: name - the program's file name
+ *				 info - filled in with the cached entry
+ *		RETURN VALUE: 0 - it can be run
+ *						  -1 - no such file, or it isn't an executable that fits
+ *		SIDE EFFECTS: may replace the cache entry of another inode
+ */
+int32_t exec_lookup(const uint8_t* name, exec_info_t* info)
+{
+	uint32_t flags;
+	uint8_t header[ELF_HEADER_SIZE];
+	int32_t header_size, j;
+	exec_info_t* cached;
+	dentry_t file_dentry;
+
+	// if it returns -1, that means the file doesn't exist
+	if(read_dentry_by_name(name, &file_dentry) == -1)
+		return -1;
+
+	if(file_dentry.file_type != REGULAR_FILE)
+		return -1; // it's not a file type
+
+	cached = &exec_cache[file_dentry.inode_idx % EXEC_CACHE_SIZE];
+	cli_and_save(flags);
+	if(cached->inode == (int32_t)file_dentry.inode_idx)
+	{
+		*info = *cached;
+		restore_flags(flags);
+		return (info->executable && info->image_end != -1) ? 0 : -1;
+	}
+	restore_flags(flags);
+
+	info->inode = file_dentry.inode_idx;
+	info->executable = 0;
+	info->entry_point = 0;
+	info->image_end = -1;
+
+	header_size = read_data(file_dentry.inode_idx, 0, header, ELF_HEADER_SIZE);
+	if(header_size >= ENTRY_POINT_START + (int32_t)sizeof(uint32_t))
+	{
+		info->executable = 1;
+		for(j = 0; j < MAGIC_NUMBER_SIZE; j++)
+			if(header[j] != magic_numbers[j])
+				info->executable = 0; // not executable
+
+		/* Extract entry point of task */
+		for(j = 0; j < (int32_t)sizeof(uint32_t); j++)
+			info->entry_point |= header[ENTRY_POINT_START + j] << (BYTE_SIZE*j);
+
+		/* the program only gets the pages it touches */
+		if(info->executable)
+			info->image_end = image_end(file_dentry.inode_idx, header, header_size);
+	}
+
+	// another process may be filling the same entry, it finds the same answer
+	cli_and_save(flags);
+	*cached = *info;
+	restore_flags(flags);
+	return (info->executable && info->image_end != -1) ? 0 : -1;
+}
+
+/*
+ * load_image_page
+ *		DESCRIPTION:
+ *			Called when the running program first touches a page of its image, or
+ *			first writes to one. Whole pages of the executable are mapped read only
+ *			straight onto the file system's data blocks, so every instance of a
+ *			program shares them. A write gets the page a private copy. Pages the
+ *			file only partly covers, and the bss, are always private.
+ *		INPUT: virtual_address - any address in the page
+ *				 write - 1 if the program is writing to it
+ *		RETURN VALUE: 0 - the page is there, -1 - not part of the image, or out of memory
+ *		SIDE EFFECTS: none
+ */
+int32_t load_image_page(uint32_t virtual_address, uint32_t write)
+{
+	pcb* process = process_array[current_process[sched_terminal]];
+	uint32_t page = virtual_address & ~(FRAME_SIZE - 1);
+	uint32_t offset = page - PROGRAM_START;
+	uint32_t* entry = &process->program_table[(page & CLEAR_DIR_IDX) >> TABLE_IDX_SHIFT];
+	uint32_t file_size = inodes[process->image_inode].file_size;
+	int32_t block, copied = 0;
+
+	if(virtual_address < PROGRAM_START || virtual_address >= process->image_end)
+		return -1;
+
+	if(*entry & COW_PAGE)
+		return -1; // copy_on_write's, dropping it would lose what the page holds
+
+	if((*entry & PRESENT_BIT) && (*entry & RW_SET_ONLY))
+		return 0; // already private
+
+	// share the file's block until somebody writes
+	if(!(*entry & PRESENT_BIT) && !write && offset + FRAME_SIZE <= file_size &&
+		(block = get_block_addr(process->image_inode, offset / FRAME_SIZE)) != -1)
+	{
+		*entry = block | SHARED_PAGE | USER_READ_ONLY;
+		flush_tlb_page(page);
+		return 0;
+	}
+
+	// a private copy, the shared block belongs to the file system and stays
+	*entry = RW_SET_ONLY; // not present
+	if(map_process_pages(process->process_id, page, 1) == -1)
+		return -1;
+	flush_tlb_page(page);
+
+	if(offset < file_size)
+	{
+		copied = read_data(process->image_inode, offset, (uint8_t*)page,
+				(file_size - offset < FRAME_SIZE) ? file_size - offset : FRAME_SIZE);
+		if(copied == -1)
+			return -1;
 	}
+	memset((uint8_t*)page + copied, 0, FRAME_SIZE - copied); // the bss
+	return 0;
 }
 
 /*
@@ -59,11 +378,21 @@ void pc_init(){
  */
 int32_t halt(uint8_t status)
 {
+	// the scheduler can't switch to us while the pcb and stacks are torn down,
+	// the parent's iret turns interrupts back on
+	cli();
 	close_all_fd(); // gotta do it before the restart
+	free_process_pages(current_process[sched_terminal]); // the next add_process flushes them
+
+	/* a forked process has no execute to return to, it just goes away */
+	if(process_array[current_process[sched_terminal]]->forked) {
+		exception_flag = 0;
+		sched_exit();
+	}
 
 	/* if terminating current terminals original shell, restart shell */
-	if(process_array[current_process[curr_terminal]]->process_id < 3){
-		in_use[process_array[current_process[curr_terminal]]->process_id] = 0;
+	if(process_array[current_process[sched_terminal]]->process_id < 3){
+		current_process[sched_terminal] = -1; // execute gives it the terminal's pid again
 		execute((uint8_t*)"shell");
 	}
 
@@ -75,24 +404,29 @@ int32_t halt(uint8_t status)
 	asm volatile(
 		"movl %0, %%esp \n"
 		:
-		: "r"(process_array[current_process[curr_terminal]]->current_esp)
+		: "r"(process_array[current_process[sched_terminal]]->current_esp)
 	);
 
 	asm volatile(
 		"movl %0, %%ebp \n"
 		:
-		: "r"(process_array[current_process[curr_terminal]]->current_ebp)
+		: "r"(process_array[current_process[sched_terminal]]->current_ebp)
 	);
 
 	/* revert process controller info to parent process */
-	in_use[current_process[curr_terminal]] = 0;
-	current_process[curr_terminal] = process_array[current_process[curr_terminal]]->parent_id;
+	halted_pid = current_process[sched_terminal];
+	sched_dequeue(halted_pid);
+	current_process[sched_terminal] = process_array[halted_pid]->parent_id;
+	sched_enqueue(current_process[sched_terminal]);
 
 	/* prepare paging for context switch */
-	add_process(current_process[curr_terminal]);
+	add_process(current_process[sched_terminal]);
+
+	/* we're on the parent's stack now, the child's can go */
+	process_free(halted_pid);
 
 	/* prepare tss for context switch */
-	tss.esp0 = process_array[current_process[curr_terminal]]->current_esp;
+	tss.esp0 = KERNEL_STACK_TOP(current_process[sched_terminal]);
 	tss.ss0  = KERNEL_DS;
 
 	/* set return value */
@@ -138,9 +472,9 @@ void parse_cmd_args(uint8_t* buf, const uint8_t* comm)
 	int32_t arg_cnt = i; // start parsing from where the command left off
 	// parse till end of character or max buffer size
 	for(; comm[arg_cnt] != '\0' && arg_cnt != TERM_BUFF_SIZE; arg_cnt++) // get all the arguments
-		cmd_args[curr_terminal][arg_cnt - file_name_length] = comm[arg_cnt];
+		cmd_args[sched_terminal][arg_cnt - file_name_length] = comm[arg_cnt];
 
-	cmd_args[curr_terminal][arg_cnt - file_name_length] = '\0'; // terminate the string
+	cmd_args[sched_terminal][arg_cnt - file_name_length] = '\0'; // terminate the string
 }
 
 /*
@@ -184,96 +518,103 @@ int32_t execute(const uint8_t* comm)
 	file_name[i] = '\0';
 	file_name_length = i;
 
-	// if it returns -1, that means the file doesn't exist
-	dentry_t file_dentry;
-	if(read_dentry_by_name((uint8_t*)file_name, &file_dentry) == -1) // get the data
+	// the file has to exist and be an executable that fits below the stack
+	exec_info_t program;
+	if(exec_lookup((uint8_t*)file_name, &program) == -1)
 		return -1;
 
-	if(file_dentry.file_type != 2)
-		return -1; // it's not a file type
+	// another terminal can't take the same pid
+	uint32_t flags;
+	cli_and_save(flags);
 
-	// Read first 4 bytes to see if its an executable
-	uint8_t buf[BYTES_TO_READ];
-	uint32_t read_bytes = BYTES_TO_READ;
+	// a terminal's base shell always gets the terminal's pid, anyone else a free one
+	if(current_process[sched_terminal] == -1)
+		i = sched_terminal;
+	else if((i = alloc_pid()) == -1) {
+		restore_flags(flags);
+		printf("Maximum Possible Processes. Stop and Reconsider.\n");
+		return -1;  // too many processes, Piazza post @1089, shouldn't be 0
+	}
 
-	if(read_data(file_dentry.inode_idx, 0, buf, read_bytes) == -1)
+	if(process_alloc(i) == -1) {
+		free_pid(i); // never got its memory
+		restore_flags(flags);
+		printf("Out of memory.\n");
 		return -1;
-
-	// find the next unused process
-	for(i = 0; i < MAX_PROCESSES; i++) {
-		if(in_use[i] == 0) {
-			in_use[i] = 1;
-			break;
-		}
 	}
 
-	if(i >= MAX_PROCESSES) {
-		printf("Maximum Possible Processes. Stop and Reconsider.\n");
-		return -1;  // too many processes, Piazza post @1089, shouldn't be 0
+	if(map_process_pages(i, USER_STACK_BOTTOM, USER_STACK_PAGES) == -1) {
+		free_process_pages(i);
+		process_free(i);
+		restore_flags(flags);
+		printf("Out of memory.\n");
+		return -1;
 	}
 
 	/* create pcb and initialize it */
-	pcb * process_pcb = (pcb *)(K_STACK_BOTTOM - PROCESS_SIZE*(1+i));
-	process_array[i] = process_pcb;
+	pcb * process_pcb = process_array[i];
 	process_pcb->process_id = i;
+	process_pcb->terminal = sched_terminal;
+	process_pcb->image_inode = program.inode;
+	process_pcb->image_end = program.image_end;
+	process_pcb->forked = 0;
+	process_pcb->pending_signals = 0;
+	process_pcb->blocked_signals = 0;
+	memset(process_pcb->signal_handlers, 0, sizeof(process_pcb->signal_handlers));
+	memset(process_pcb->syscall_counts, 0, sizeof(process_pcb->syscall_counts));
 
 	if(i < 3) { // is this the first program?
 		process_pcb->parent_id = -1;
 	}
 	else{
-		process_pcb->parent_id = current_process[curr_terminal];
+		process_pcb->parent_id = current_process[sched_terminal];
 	}
-	current_process[curr_terminal] = i;
+
+	// the child runs in place of its parent
+	sched_dequeue(process_pcb->parent_id);
+	current_process[sched_terminal] = i;
+	sched_enqueue(i);
+	restore_flags(flags);
 
 	// copy the arguments from parsing into the pcb
-	strcpy((int8_t*)process_array[current_process[curr_terminal]]->args, cmd_args[curr_terminal]);
+	strcpy((int8_t*)process_array[current_process[sched_terminal]]->args, cmd_args[sched_terminal]);
 
 	fd_table_init(process_pcb->fd_table); // initialize this process's fd table
-
-	int j;
-	for(j = 0; j < MAGIC_NUMBER_SIZE; j++) {
-		if(buf[j] != magic_numbers[j]) {
-			return -1; // not executable
-		}
-	}
-
-	/* Extract entry point of task */
-	uint32_t entry_point = 0;
-	for(j = ENTRY_POINT_START; j < BYTES_TO_READ; j++) {
-		entry_point |= (buf[j] << (BYTE_SIZE*(j-ENTRY_POINT_START)));
+	if(process_pcb->parent_id != -1)
+	{	// stdin and stdout are handed down, so a program can run at either end of a pipe
+		fd_t* parent_fds = process_array[process_pcb->parent_id]->fd_table;
+		process_pcb->fd_table[STDIN_] = parent_fds[STDIN_];
+		process_pcb->fd_table[STDOUT_] = parent_fds[STDOUT_];
+		pipe_dup(&process_pcb->fd_table[STDIN_]);
+		pipe_dup(&process_pcb->fd_table[STDOUT_]);
 	}
+	clear_user_pages(process_pcb->process_id); // drop the last owner's file mappings
+	shm_reap();
 
 	/* set up paging */
 	add_process(process_pcb->process_id);
 
-	/* read file into memory */
-	dentry_t dentry;
-	uint32_t address = PROGRAM_START;
-	if(read_dentry_by_name((uint8_t*) file_name, &dentry) == -1) {
-		return -1;
-	}
-
-	if(read_data(dentry.inode_idx, 0, (uint8_t *)address, inodes[dentry.inode_idx].file_size) == -1) {
-		return -1;
-	}
+	/* fresh frames hold whatever the last owner left, the program's pages are
+	 * read from the file by load_image_page when it first touches them */
+	memset((void*)USER_STACK_BOTTOM, 0, USER_STACK_PAGES*FRAME_SIZE);
 
 	/* prepare tss for context switch */
-	tss.esp0 = K_STACK_BOTTOM - PROCESS_SIZE * (current_process[curr_terminal]) - BYTE_SIZE/2;
+	tss.esp0 = KERNEL_STACK_TOP(current_process[sched_terminal]);
 	tss.ss0 = KERNEL_DS;
 
 	/* store current esp and ebp for halt */
 	asm volatile(
 		"movl %%esp, %0 \n"
-		: "=r"(process_array[current_process[curr_terminal]]->current_esp)
+		: "=r"(process_array[current_process[sched_terminal]]->current_esp)
 	);
 
 	asm volatile(
 		"movl %%ebp, %0 \n"
-		: "=r"(process_array[current_process[curr_terminal]]->current_ebp)
+		: "=r"(process_array[current_process[sched_terminal]]->current_ebp)
 	);
 
 	/* push IRET context to stack and IRET */
-	user_context_switch(entry_point);
+	user_context_switch(program.entry_point);
 
 	/* used for halting */
 	asm volatile ("execute_return: ");
@@ -322,11 +663,11 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes)
 		return -1; // invalid fd
 	}
 
-	if(buf == NULL)
-		return -1; // invalid pointer
+	if(bad_userspace_addr(buf, nbytes, 1))
+		return -1; // invalid pointer, or not all of it is the program's
 
  	// get the function pointer to the specific file or rtc or thing
-	return (((((process_array[current_process[curr_terminal]])->fd_table)[fd]).fd_jump)->read)(fd, (uint8_t*)buf, nbytes);
+	return (((((process_array[current_process[sched_terminal]])->fd_table)[fd]).fd_jump)->read)(fd, (uint8_t*)buf, nbytes);
 }
 
 /* JC
@@ -354,11 +695,11 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes)
 		return -1; // invalid fd
 	}
 
-	if(buf == NULL)
-		return -1; // invalid pointer
+	if(bad_userspace_addr(buf, nbytes, 0))
+		return -1; // invalid pointer, or not all of it is the program's
 
  	// get the function pointer to the specific file or rtc or thing
-	return (((((process_array[current_process[curr_terminal]])->fd_table)[fd]).fd_jump)->write)(fd, buf, nbytes);
+	return (((((process_array[current_process[sched_terminal]])->fd_table)[fd]).fd_jump)->write)(fd, buf, nbytes);
 }
 
 /* JC
@@ -419,7 +760,7 @@ int32_t close(int32_t fd)
 	}
 
  	// get the function pointer for the unknown function
-	return (((((process_array[current_process[curr_terminal]])->fd_table)[fd]).fd_jump)->close)(fd);
+	return (((((process_array[current_process[sched_terminal]])->fd_table)[fd]).fd_jump)->close)(fd);
 }
 
 /* JC
@@ -448,7 +789,7 @@ int32_t getargs(uint8_t* buf, int32_t nbytes)
 	uint32_t i = 0;
 	while(i < nbytes && i < TERM_BUFF_SIZE)
 	{ 	// copy the data over
-		buf[i] = ((process_array[current_process[curr_terminal]])->args)[i];
+		buf[i] = ((process_array[current_process[sched_terminal]])->args)[i];
 		i++;
 	}
 
@@ -496,15 +837,14 @@ int32_t vidmap(uint8_t** screen_start)
 		return -1;
 	}
 
-	// check if parameter is within page allocated for user program
-	if(screen_start < (uint8_t**)PROGRAM_PAGE ||
-		screen_start >= (uint8_t**)(PROGRAM_PAGE + USER_PAGE_SIZE)) {
+	// check if parameter is within the pages allocated for the user program
+	if(bad_userspace_addr(screen_start, sizeof(*screen_start), 1)) {
 		printf("pointer out of range, vidmap\n");
 		return -1;
 	}
 
 	// give user virtual adress, specific to its terminal
-	switch(curr_terminal)
+	switch(sched_terminal)
 	{
 		// terminal 1
 		case 0: 
@@ -520,10 +860,8 @@ int32_t vidmap(uint8_t** screen_start)
 			break;
 	}
 
-	// if(curr_terminal == sched_proc)
-		map_virt_to_phys((uint32_t)(*screen_start), USER_VIDEO_);
-	// else
-		// map_virt_to_phys((uint32_t)(*screen_start), BASE_VIRT1+(sched_proc))
+	// every terminal always draws into its own page, displayed or not
+	map_virt_to_phys((uint32_t)(*screen_start), USER_BACK1 + sched_terminal*(USER_BACK2 - USER_BACK1));
 
 	return (int32_t)*screen_start; // return the virtual address
 }
@@ -531,30 +869,451 @@ int32_t vidmap(uint8_t** screen_start)
 /* JC
  * int32_t set_handler(int32_t signum, void* handler_address)
  * 	DESCRIPTION:
- * 	INPUT: signum -
- *				 handler_address -
+ *			Changes what happens when the process gets a signal. The handler is
+ *			called with the signal number, other signals wait until it returns.
+ * 	INPUT: signum - the signal
+ *				 handler_address - the program's handler, NULL for the default action
  *		OUTPUT:
- *		RETURN VALUE:
+ *		RETURN VALUE: 0 - success
+ *						  -1 - no such signal, or the handler isn't in the program
  *		SIDE EFFECTS:
  *
  */
 int32_t set_handler(int32_t signum, void* handler_address)
 {
- 	return -1;
+	if(signum < 0 || signum >= NUM_SIGNALS)
+		return -1;
+	if(handler_address != NULL && bad_userspace_addr(handler_address, 1, 0))
+		return -1;
+
+	process_array[current_process[sched_terminal]]->signal_handlers[signum] = handler_address;
+	return 0;
 }
 
 /* JC
  * int32_t sigreturn(void)
  * 	DESCRIPTION:
+ *			Called by the code a signal handler returns into. Puts back the
+ *			registers the program had when the signal came, including any
+ *			change the handler made to them on its stack.
  * 	INPUT: none
  *		OUTPUT:
- *		RETURN VALUE:
- *		SIDE EFFECTS:
+ *		RETURN VALUE: the restored eax, so the program sees the value it had
+ *						  -1 - the saved registers aren't on the user stack
+ *		SIDE EFFECTS: the process gets signals again
  *
  */
 int32_t sigreturn(void)
 {
- 	return -1;
+	return signal_return(USER_CONTEXT(current_process[sched_terminal]));
+}
+
+/*
+ * int32_t mmap(int32_t fd, uint8_t** start)
+ * 	DESCRIPTION:
+ *			Maps a whole file read only into the caller's file mapping window. The
+ *			pages point straight at the file's data blocks in the filesystem image,
+ *			nothing is copied. Bytes past the end of the file in the last page are
+ *			not part of the file.
+ * 	INPUT:
+ *			fd - an open regular file
+ *			start - A pointer to the location that should hold the start of the mapping
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad fd, bad pointer, or no room in the window
+ *						  the size of the file in bytes, 0 maps nothing
+ *		SIDE EFFECTS: adds pages to the caller's mmap page table
+ *
+ */
+int32_t mmap(int32_t fd, uint8_t** start)
+{
+	fd_t* file_fd = get_fd(fd);
+	uint32_t pid = current_process[sched_terminal];
+	uint32_t file_size, num_pages, page;
+	int32_t virt, block_addr;
+
+	// only regular files have data blocks
+	if(file_fd == NULL || file_fd->flags == FD_OFF || file_fd->fd_jump != &filesys_ops_table)
+		return -1;
+
+	// check if parameter is within the pages allocated for user program
+	if(bad_userspace_addr(start, sizeof(*start), 1))
+		return -1;
+
+	file_size = inodes[file_fd->inode_ptr].file_size;
+	if(file_size == 0)
+	{
+		*start = NULL;
+		return 0;
+	}
+	num_pages = (file_size + MAX_CHARS_IN_DATA - 1) / MAX_CHARS_IN_DATA;
+
+	if((virt = find_map_pages(pid, num_pages)) == -1)
+		return -1; // window is full
+
+	for(page = 0; page < num_pages; page++)
+	{
+		if((block_addr = get_block_addr(file_fd->inode_ptr, page)) == -1)
+		{
+			unmap_user_pages(pid, virt, page); // undo what's mapped so far
+			return -1;
+		}
+		map_user_page(pid, virt + page*MAX_CHARS_IN_DATA, block_addr);
+	}
+
+	*start = (uint8_t*)virt;
+	return file_size;
+}
+
+/*
+ * int32_t munmap(uint8_t* start, int32_t length)
+ * 	DESCRIPTION:
+ *			Removes a mapping made by mmap or shmmap.
+ * 	INPUT:
+ *			start - the address mmap or shmmap gave back
+ *			length - the size they returned
+ *		OUTPUT:
+ *		RETURN VALUE: 0 - success, -1 - not a file mapping
+ *		SIDE EFFECTS: removes pages from the caller's mmap page table, a shared
+ *						  memory segment nobody maps anymore is freed
+ *
+ */
+int32_t munmap(uint8_t* start, int32_t length)
+{
+	int32_t ret;
+
+	if(length <= 0)
+		return -1;
+	ret = unmap_user_pages(current_process[sched_terminal], (uint32_t)start,
+			(length + MAX_CHARS_IN_DATA - 1) / MAX_CHARS_IN_DATA);
+	shm_reap();
+	return ret;
+}
+
+/*
+ * int32_t getdents(int32_t fd, void* buf, int32_t nbytes)
+ * 	DESCRIPTION:
+ *			Reads as many directory entries as fit into buf in one call, each one a
+ *			dirent_t with the name, type, inode and size. Saves a read call per entry.
+ * 	INPUT:
+ *			fd - an open directory
+ *			buf - where the records go, must be in the user program's page
+ *			nbytes - size of buf
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad fd or buffer
+ *						  number of bytes filled, 0 once every entry was read
+ *		SIDE EFFECTS: moves the directory's offset
+ *
+ */
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes)
+{
+	fd_t* dir_fd = get_fd(fd);
+
+	if(dir_fd == NULL || dir_fd->flags == FD_OFF || dir_fd->fd_jump != &dir_ops_table)
+		return -1;
+
+	// the whole buffer must be within the pages allocated for user program
+	if(nbytes <= 0 || bad_userspace_addr(buf, nbytes, 1))
+		return -1;
+
+	return dir_getdents(fd, (uint8_t*)buf, nbytes);
+}
+
+/*
+ * int32_t kmstat(void* buf, int32_t nbytes)
+ * 	DESCRIPTION:
+ *			Copies the statistics of the kernel's object caches, one record per cache.
+ * 	INPUT:
+ *			buf - where the records go, must be in the user program's pages
+ *			nbytes - size of buf
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad buffer
+ *						  number of bytes filled
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t kmstat(void* buf, int32_t nbytes)
+{
+	if(nbytes <= 0 || bad_userspace_addr(buf, nbytes, 1))
+		return -1;
+
+	return kmem_stats((kmem_stat_t*)buf, nbytes);
+}
+
+/*
+ * int32_t pipe(int32_t* fds)
+ * 	DESCRIPTION:
+ *			Makes a pipe. Whatever is written to the second descriptor can be read
+ *			from the first, by this process or any it forks or executes.
+ * 	INPUT:
+ *			fds - two descriptors, read end then write end, in the user program's pages
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad pointer, no free descriptors, or out of memory
+ *						  0 - success
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t pipe(int32_t* fds)
+{
+	if(bad_userspace_addr(fds, 2 * sizeof(int32_t), 1))
+		return -1;
+
+	return pipe_create(fds);
+}
+
+/*
+ * int32_t shmmap(const uint8_t* name, int32_t nbytes, uint8_t** start)
+ * 	DESCRIPTION:
+ *			Maps the shared memory segment called name, writable. The first
+ *			process to map a name makes the segment, nbytes rounded up to 4kb
+ *			pages, zeroed. The others get the same pages. Forked children keep
+ *			the mapping. The segment lasts until nobody maps it anymore, munmap
+ *			and halt unmap it.
+ * 	INPUT:
+ *			name - up to 31 characters
+ *			nbytes - size of a new segment, what has to fit in an existing one
+ *			start - set to where the segment is mapped
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad name or pointer, too big, or out of memory
+ *						  size of the segment in bytes
+ *		SIDE EFFECTS: uses up pages of the file mapping window
+ *
+ */
+int32_t shmmap(const uint8_t* name, int32_t nbytes, uint8_t** start)
+{
+	int8_t seg_name[SHM_NAME_LENGTH];
+	int32_t i;
+
+	if(nbytes < 0 || bad_userspace_addr(start, sizeof(*start), 1))
+		return -1;
+
+	// a byte at a time, the name may end right before an unmapped page
+	for(i = 0; i < SHM_NAME_LENGTH; i++)
+	{
+		if(bad_userspace_addr(name + i, 1, 0))
+			return -1;
+		if((seg_name[i] = name[i]) == '\0')
+			break;
+	}
+	if(i == 0 || i == SHM_NAME_LENGTH)
+		return -1; // empty or too long
+
+	return shm_map(seg_name, nbytes, start);
+}
+
+/*
+ * int32_t futex_wait(int32_t* addr, int32_t expected)
+ * 	DESCRIPTION:
+ *			Sleeps until futex_wake is called on the same word, if it still holds
+ *			expected. A user lock only calls this when it has to wait.
+ * 	INPUT:
+ *			addr - a 4 byte aligned word the program can write
+ *			expected - what the caller last saw in it
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad address, or the word changed already
+ *						  0 - woken up
+ *		SIDE EFFECTS: a page fork shared is copied first, so the word is the
+ *						  caller's own like futex_wake will see it
+ *
+ */
+int32_t futex_wait(int32_t* addr, int32_t expected)
+{
+	if(((uint32_t)addr & (sizeof(int32_t) - 1)) || bad_userspace_addr(addr, sizeof(int32_t), 1))
+		return -1;
+
+	return futex_wait_on(user_to_phys((uint32_t)addr), addr, expected);
+}
+
+/*
+ * int32_t futex_wake(int32_t* addr, int32_t n)
+ * 	DESCRIPTION:
+ *			Wakes up to n processes sleeping in futex_wait on the same word, in
+ *			any process that maps its page.
+ * 	INPUT:
+ *			addr - a 4 byte aligned word the program can write
+ *			n - how many to wake at most
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad address
+ *						  the number woken
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t futex_wake(int32_t* addr, int32_t n)
+{
+	if(((uint32_t)addr & (sizeof(int32_t) - 1)) || bad_userspace_addr(addr, sizeof(int32_t), 1))
+		return -1;
+
+	return futex_wake_up(user_to_phys((uint32_t)addr), n);
+}
+
+/*
+ * int32_t ktrace(void* buf, int32_t nbytes)
+ * 	DESCRIPTION:
+ *			Moves the kernel's trace events that weren't read yet out to the
+ *			program, oldest first.
+ * 	INPUT:
+ *			buf - where the events go, must be in the user program's pages
+ *			nbytes - size of buf
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad buffer, or the kernel was built without KERNEL_TRACE
+ *						  number of bytes filled
+ *		SIDE EFFECTS: the events are gone from the ring
+ *
+ */
+int32_t ktrace(void* buf, int32_t nbytes)
+{
+#ifdef KERNEL_TRACE
+	if(nbytes <= 0 || bad_userspace_addr(buf, nbytes, 1))
+		return -1;
+
+	return trace_drain((trace_event_t*)buf, nbytes);
+#else
+	return -1;
+#endif
+}
+
+/*
+ * int32_t sysstat(int32_t pid, void* buf, int32_t nbytes)
+ * 	DESCRIPTION:
+ *			Copies how often each system call was made and how long the calls
+ *			took, one record per system call number.
+ * 	INPUT:
+ *			pid - the process whose own counts go in the records too, -1 for none
+ *			buf - where the records go, must be in the user program's pages
+ *			nbytes - size of buf
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - bad buffer
+ *						  number of bytes filled
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t sysstat(int32_t pid, void* buf, int32_t nbytes)
+{
+	if(nbytes <= 0 || bad_userspace_addr(buf, nbytes, 1))
+		return -1;
+
+	return sysstat_fill(pid, (sysstat_t*)buf, nbytes);
+}
+
+/*
+ * int32_t isatty(int32_t fd)
+ * 	DESCRIPTION:
+ *			Tells whether a descriptor is the keyboard or the terminal, so a
+ *			program can tell when the shell handed it a pipe instead.
+ * 	INPUT:
+ *			fd - the descriptor
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - fd isn't open
+ *						  1 - keyboard or terminal
+ *						  0 - anything else
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t isatty(int32_t fd)
+{
+	fd_t* file_fd;
+
+	if(!check_valid_fd(fd))
+		return -1;
+
+	file_fd = get_fd(fd);
+	return (file_fd->fd_jump == &kybd_ops_table || file_fd->fd_jump == &term_ops_table);
+}
+
+/*
+ * int32_t dup2(int32_t old_fd, int32_t new_fd)
+ * 	DESCRIPTION:
+ *			Makes new_fd refer to what old_fd does, closing whatever new_fd was.
+ *			stdin and stdout can be replaced this way, and a copy of them at
+ *			another descriptor can be closed.
+ * 	INPUT:
+ *			old_fd - an open descriptor
+ *			new_fd - any descriptor
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - invalid descriptor
+ *						  new_fd - success
+ *		SIDE EFFECTS: none
+ *
+ */
+int32_t dup2(int32_t old_fd, int32_t new_fd)
+{
+	uint32_t flags;
+	fd_t* table;
+
+	if(!check_valid_fd(old_fd) || new_fd < 0 || new_fd >= MAX_OPEN_FILES)
+		return -1;
+	if(old_fd == new_fd)
+		return new_fd;
+
+	cli_and_save(flags);
+	table = process_array[current_process[sched_terminal]]->fd_table;
+	pipe_release(&table[new_fd]);
+	table[new_fd] = table[old_fd];
+	pipe_dup(&table[new_fd]);
+	restore_flags(flags);
+
+	return new_fd;
+}
+
+/*
+ * int32_t do_fork(uint32_t frame)
+ * 	DESCRIPTION:
+ *			The fork system call, fork in wrapper.S saves the registers and calls
+ *			this. The child gets a copy of the pcb, the fd table and the kernel
+ *			stack, and shares the parent's pages until one of them writes. It
+ *			starts from its copy of the saved registers and returns 0 from fork.
+ * 	INPUT:
+ *			frame - the parent's kernel esp pointing at the saved registers
+ *		OUTPUT:
+ *		RETURN VALUE: -1 - out of pids or memory
+ *						  the child's pid, to the parent
+ *		SIDE EFFECTS: the child is put on the run queue
+ *
+ */
+int32_t do_fork(uint32_t frame)
+{
+	uint32_t flags;
+	int32_t parent = current_process[sched_terminal];
+	int32_t child;
+	pcb *from, *to;
+
+	cli_and_save(flags);
+
+	if((child = alloc_pid()) == -1) {
+		restore_flags(flags);
+		return -1;
+	}
+	if(process_alloc(child) == -1) {
+		free_pid(child);
+		restore_flags(flags);
+		return -1;
+	}
+
+	from = process_array[parent];
+	to = process_array[child];
+	to->process_id = child;
+	to->parent_id = parent;
+	to->terminal = from->terminal;
+	to->image_inode = from->image_inode;
+	to->image_end = from->image_end;
+	to->forked = 1;
+	to->pending_signals = 0; // the handlers and the blocked ones come along
+	to->blocked_signals = from->blocked_signals;
+	memcpy(to->signal_handlers, from->signal_handlers, sizeof(to->signal_handlers));
+	to->syscall_start = from->syscall_start; // the child finishes our fork too
+	memset(to->syscall_counts, 0, sizeof(to->syscall_counts));
+	memcpy(to->args, from->args, MAX_CHARS);
+	memcpy(to->fd_table, from->fd_table, sizeof(fd_t) * FD_TABLE_SIZE);
+	fd_table_dup(to->fd_table);
+
+	fork_pages(parent, child);
+
+	// the child's stack is the same as ours, so it resumes from the same frame
+	memcpy((void*)to->kernel_stack, (void*)from->kernel_stack, PROCESS_SIZE);
+	to->sched_esp = to->kernel_stack + (frame - from->kernel_stack);
+	sched_enqueue(child);
+
+	restore_flags(flags);
+	return child;
 }
 
 /* Returns -1 if the passed in cmd is invalid
@@ -6,19 +6,24 @@
 #include "x86_desc.h"
 #include "fd_table.h"
 #include "exceptions.h"
+#include "sysstat.h"
 
-#define K_STACK_BOTTOM		0x00800000
 #define PROGRAM_PAGE		0x08000000
 #define PROGRAM_START		0x08048000
 #define USER_PAGE_SIZE		0x00400000
 #define PROCESS_SIZE     	0x00002000
+/* top of the 8KB kernel stack that belongs to a process */
+#define KERNEL_STACK_TOP(pid)	(process_array[pid]->kernel_stack + PROCESS_SIZE - BYTE_SIZE/2)
+/* the registers a process saved when it went into the kernel from user mode */
+#define USER_CONTEXT(pid)		((hw_context_t*)KERNEL_STACK_TOP(pid) - 1)
 
 /* Additional Macros */
-#define MAX_PROCESSES 8
+#define MAX_PROCESSES 64 // size of the pid table, pcbs and stacks are allocated as needed
 #define FD_TABLE_SIZE 8
 #define MAX_CHARS 128
 #define BYTE_MASK	0xFF
 #define BYTE_SIZE	8
+#define EXEC_CACHE_SIZE 16 // executables execute remembers the headers of
 
 /* per process data structure */
 typedef struct process_control_block {
@@ -26,21 +31,50 @@ typedef struct process_control_block {
 	int32_t     parent_id;
 	uint32_t    current_esp;
 	uint32_t    current_ebp;
-	uint32_t		return_esp;
-	uint32_t		return_ebp;
+	uint32_t		sched_esp;	// saved kernel stack when the scheduler switches away
+	uint32_t		terminal;	// terminal the process was started in
+	uint32_t		kernel_stack;	// bottom of its 8KB kernel stack
+	uint32_t		image_inode;	// the executable, its pages are loaded on first touch
+	uint32_t		image_end;	// first address past the program image
+	uint32_t		forked;		// made by fork, halt has no execute to return to
+	uint32_t*	program_table;	// page table of the program page
+	uint32_t*	mmap_table;		// page table of the file mapping window
 	uint8_t     args[MAX_CHARS];
-	fd_t 			fd_table[FD_TABLE_SIZE];
+	fd_t*			fd_table;	// FD_TABLE_SIZE entries
+	uint32_t		pending_signals;	// bit per signal, handled on the way back to user mode
+	uint32_t		blocked_signals;	// all of them while a handler runs
+	void*			signal_handlers[NUM_SIGNALS];	// NULL for the default action
+	uint64_t		syscall_start;	// time stamp counter when the current system call began
+	uint32_t		syscall_counts[NUM_SYSCALLS];
 } pcb;
 
+/* what execute needs from an executable's ELF header */
+typedef struct exec_info_t {
+	int32_t		inode;			// -1 marks an empty cache entry
+	uint32_t		executable;		// the magic number checked out
+	uint32_t		entry_point;
+	int32_t		image_end;		// first address past the image, -1 if it doesn't fit
+} exec_info_t;
+
 /* holds all the processing info */
 /* process controller */
 // int no_processes; // how many processes per terminal
 // total pool of functions, first three should always be the terminals
-pcb * process_array[MAX_PROCESSES]; //pcb pointers for each process
-int32_t in_use[MAX_PROCESSES];
+pcb * process_array[MAX_PROCESSES]; //pcb pointers for each process, NULL if the pid is free
 
 /* initializes the process controller */
 void pc_init();
+
+/* kernel stack, pcb and page tables of a pid */
+int32_t process_alloc(int32_t pid);
+void process_free(int32_t pid);
+
+/* the header checks of execute, cached by inode */
+int32_t exec_lookup(const uint8_t* name, exec_info_t* info);
+void exec_cache_flush();
+
+/* demand loading of the running program's image */
+int32_t load_image_page(uint32_t virtual_address, uint32_t write);
 void parse_cmd_args(uint8_t* buf, const uint8_t* comm);
 
 /* System Call Prototypes */
@@ -54,6 +88,20 @@ int32_t getargs(uint8_t* buf, int32_t nbytes);
 int32_t vidmap(uint8_t** screen_start);
 int32_t set_handler(int32_t signum, void* handler_address);
 int32_t sigreturn(void);
+int32_t mmap(int32_t fd, uint8_t** start);
+int32_t munmap(uint8_t* start, int32_t length);
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes);
+int32_t kmstat(void* buf, int32_t nbytes);
+int32_t pipe(int32_t* fds);
+int32_t dup2(int32_t old_fd, int32_t new_fd);
+int32_t shmmap(const uint8_t* name, int32_t nbytes, uint8_t** start);
+int32_t futex_wait(int32_t* addr, int32_t expected);
+int32_t futex_wake(int32_t* addr, int32_t n);
+int32_t ktrace(void* buf, int32_t nbytes);
+int32_t sysstat(int32_t pid, void* buf, int32_t nbytes);
+int32_t isatty(int32_t fd);
+int32_t fork(void);
+int32_t do_fork(uint32_t frame);
 int32_t def_cmd(void);
 
 #endif /* _SYSCALL_H */
@@ -0,0 +1,107 @@
+/*
+ * sysstat.c - System call counters and latency histograms.
+ *
+ *		wrapper.S calls syscall_enter and syscall_exit around every system
+ *		call, on the int 0x80 and the sysenter path. The entry's time stamp
+ *		counter reading is kept in the pcb, a process only makes one call at a
+ *		time. The exit counts the call for the process and for the whole
+ *		system, and adds its cycles to a histogram with a bucket per power of
+ *		2. A call the process sleeps in counts the time it slept.
+ */
+
+#include "sysstat.h"
+#include "syscall.h"
+#include "terminal.h"
+
+static sysstat_t stats[NUM_SYSCALLS]; // process_calls isn't used here
+
+/*
+ * log2_bucket - helper
+ *		DESCRIPTION: The histogram bucket of a call that took cycles.
+ *		INPUT: cycles - the call's length
+ *		RETURN VALUE: the index of the highest set bit, 0 for 0 cycles,
+ *					  the last bucket for anything past 32 bits
+ */
+static uint32_t log2_bucket(uint64_t cycles)
+{
+	uint32_t bucket;
+
+	if(cycles >> LATENCY_BUCKETS)
+		return LATENCY_BUCKETS - 1;
+	if((uint32_t)cycles == 0)
+		return 0;
+
+	asm("bsrl %1, %0" : "=r"(bucket) : "rm"((uint32_t)cycles));
+	return bucket;
+}
+
+/*
+ * syscall_enter
+ *		DESCRIPTION: Notes when the running process went into a system call.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ */
+void syscall_enter()
+{
+	int32_t pid = current_process[sched_terminal];
+
+	if(pid >= 0 && process_array[pid] != NULL)
+		process_array[pid]->syscall_start = rdtsc();
+}
+
+/*
+ * syscall_exit
+ *		DESCRIPTION: Counts a finished system call and how long it took.
+ *		INPUT: num - the system call number, anything past the dispatcher counts as 0
+ *		RETURN VALUE: none
+ */
+void syscall_exit(uint32_t num)
+{
+	uint32_t flags;
+	int32_t pid = current_process[sched_terminal];
+	uint64_t cycles;
+
+	if(pid < 0 || process_array[pid] == NULL)
+		return;
+	if(num >= NUM_SYSCALLS)
+		num = 0;
+
+	cycles = rdtsc() - process_array[pid]->syscall_start;
+	process_array[pid]->syscall_counts[num]++;
+
+	cli_and_save(flags);
+	stats[num].calls++;
+	stats[num].cycles += cycles;
+	stats[num].latency[log2_bucket(cycles)]++;
+	restore_flags(flags);
+}
+
+/*
+ * sysstat_fill
+ *		DESCRIPTION:
+ *			Copies the statistics of every system call, in system call number
+ *			order, as many as fit.
+ *		INPUT: pid - the process process_calls is for, -1 or a free pid leaves them 0
+ *				 buf - where the records go
+ *				 nbytes - size of buf
+ *		RETURN VALUE: number of bytes filled
+ */
+int32_t sysstat_fill(int32_t pid, sysstat_t* buf, int32_t nbytes)
+{
+	uint32_t flags;
+	uint32_t i;
+	int32_t filled = 0;
+	pcb* process = (pid >= 0 && pid < MAX_PROCESSES) ? process_array[pid] : NULL;
+	cli_and_save(flags);
+
+	for(i = 0; i < NUM_SYSCALLS && filled + (int32_t)sizeof(sysstat_t) <= nbytes; i++)
+	{
+		*buf = stats[i];
+		buf->process_calls = (process != NULL) ? process->syscall_counts[i] : 0;
+		buf++;
+		filled += sizeof(sysstat_t);
+	}
+
+	restore_flags(flags);
+	return filled;
+}
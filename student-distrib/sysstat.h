@@ -0,0 +1,29 @@
+/*
+ * sysstat.h - Declarations for system call counters and latency histograms.
+ *
+ */
+
+#ifndef _SYSSTAT_H
+#define _SYSSTAT_H
+
+#include "lib.h"
+
+#define NUM_SYSCALLS     24 // dispatcher entries, def_cmd included
+#define LATENCY_BUCKETS  32 // bucket b counts calls of 2^b to 2^(b+1) - 1 cycles
+
+/* what sysstat hands to user space for every system call */
+typedef struct sysstat_t {
+	uint32_t calls;			// by every process since boot
+	uint32_t process_calls;	// by the process that was asked about
+	uint64_t cycles;		// spent in all the calls together
+	uint32_t latency[LATENCY_BUCKETS];
+} sysstat_t;
+
+/* called by wrapper.S around every system call */
+void syscall_enter();
+void syscall_exit(uint32_t num);
+
+/* fills buf with a sysstat_t per system call, returns the bytes filled */
+int32_t sysstat_fill(int32_t pid, sysstat_t* buf, int32_t nbytes);
+
+#endif /* _SYSSTAT_H */
@@ -5,9 +5,7 @@
 #include "terminal.h"
 #include "filesystem.h"
 #include "syscall.h"
-#include "paging.h" // used for map_virt_to_phys
-
-#define FOURKiB	0x1000
+#include "trace.h"
 
 static int8_t save_buff[MAX_TERMINAL][TERM_BUFF_SIZE];
 
@@ -21,9 +19,6 @@ static int8_t save_buff[MAX_TERMINAL][TERM_BUFF_SIZE];
  */
 int32_t terminal_init()
 {
-	in_use[0] = 0;
-	in_use[1] = 1;
-	in_use[2] = 1;
 	return 0;
 }
 
@@ -31,8 +26,10 @@ int32_t terminal_init()
  *	terminal_switch
  *		DESCRIPTION:
  *			Upon pressing the special sequence Alt+F1, Alt+F2, or Alt+F3. This function
- *			will be called to switch all the necessary information to make the new terminal
- *			the active terminal.
+ *			will be called to switch the displayed terminal. The process running on the
+ *			CPU doesn't change, the scheduler keeps running every terminal. Every terminal
+ *			always draws into its own page of VGA memory, so switching only changes which
+ *			page the VGA displays. Nothing is copied and no mapping changes.
  *		INPUT:
  *			new_terminal - a number that represents which terminal that we are switching to.
  *		RETURN VALUE:
@@ -49,63 +46,19 @@ int32_t terminal_switch(uint32_t new_terminal){
 	if(new_terminal >= MAX_TERMINAL || new_terminal < 0)
 		return -1; // new_terminal is out of bounds
 
-	cli();
-	asm volatile(
-		"movl %%esp, %0 \n"
-		: "=r" (process_array[current_process[curr_terminal]]->return_esp)
-	);
-
-	asm volatile(
-		"movl %%ebp, %0 \n"
-		: "=r" (process_array[current_process[curr_terminal]]->return_ebp)
-	);
+	uint32_t flags;
+	cli_and_save(flags);
+	TRACE(TRACE_TERMINAL, new_terminal);
 
 	// update some variables to make the following easier to understand
 	old_terminal = curr_terminal;
 	curr_terminal = new_terminal;
 
-	/* Map old terminal's virtual address to its respective old backup */
-	map_virt_to_phys(VIRT_VID_TERM1 + (old_terminal*FOURKiB), (USER_BACK1) + (old_terminal*FOURKiB));
-	/* Copy 4kb from video memory to old terminal backup memory */
-	memcpy((void*)(VIRT_VID_TERM1 + (old_terminal*FOURKiB)), (void*)VIDEO, (uint32_t)FOURKiB);
-	/* Copy 4kb from new terminal backup memory to video memory */
-	memcpy((void*)VIDEO, (void*)(VIRT_VID_TERM1 + (curr_terminal*FOURKiB)), (uint32_t)FOURKiB);
-	/* Map new terminal's virtual address to video memory */
-	map_virt_to_phys(VIRT_VID_TERM1 + (curr_terminal*FOURKiB), USER_VIDEO_);
-
-	update_cursor();
-
-	// if we're switching to a terminal for the first time, start up the base shell.
-	if(current_process[curr_terminal] == -1)
-	{
-		in_use[curr_terminal] = 0;
-		sti();
-		execute((uint8_t*)"shell");
-	}
+	// the cursor now belongs to the new terminal
+	vid_terminal = curr_terminal;
+	show_terminal(curr_terminal);
 
-	// will only happen if a shell is running
-	/**************************************************/
-
-	/* set up paging */
-	add_process(current_process[curr_terminal]);
-
-   /* prepare tss for context switch */
-	tss.esp0 = K_STACK_BOTTOM - PROCESS_SIZE * (current_process[curr_terminal]) - BYTE_SIZE/2;
- 	tss.ss0 = KERNEL_DS;
-
-	/**************************************************/
-	/* restore esp and ebp for return */
-	asm volatile(
-		"movl %0, %%esp \n"
-		:
-		: "r"(process_array[current_process[curr_terminal]]->return_esp)
-	);
-	asm volatile(
-		"movl %0, %%ebp \n"
-		:
-		: "r"(process_array[current_process[curr_terminal]]->return_ebp)
-	);
-	sti();
+	restore_flags(flags);
 	return 0;
 }
 
@@ -158,7 +111,8 @@ int32_t terminal_read(int32_t fd, uint8_t* buf, int32_t nbytes){
 /* NM
  * terminal_write
  *		DESCRIPTION:
- *			Writes nbytes of char from the buffer to the screen through putc.
+ *			Writes nbytes of char from the buffer to the screen in one go, the
+ *			cursor is only moved once.
  *		INPUT:
  *			fd - 1 (stdout)
  *			buf - the buffer we are trying to write to screen
@@ -170,13 +124,11 @@ int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes){
 	if(buf == NULL)
 		return -1;
 
-	uint8_t* buffer = (uint8_t*)buf;
-	int32_t i=0;
-	for(i = 0; i < nbytes; i++){
-		putc(buffer[i]); // output all the charactrs in the given buffer
-	}
+	if(nbytes < 0)
+		nbytes = 0;
+	write_chars((const uint8_t*)buf, nbytes); // output all the charactrs in the given buffer
 
-	return i;
+	return nbytes;
 }
 
 /* NM
@@ -184,30 +136,34 @@ int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes){
  *		DESCRIPTION:
  *			Closes the terminal from use, a driver operation
  *		INPUT:
- *			fd - 1, stdout should always be open until end of kernel.
+ *			fd - stdout should always be open until end of kernel, only copies
+ *				  of it made by dup2 can be closed.
  *		RETURN VALUE:
  *			0 - success
  */
 int32_t terminal_close(int32_t fd){
-	return -1;
+	if(fd < FIRST_VALID_INDEX)
+		return -1;
+	close_fd(fd);
+	return 0;
 }
 
 /* NM, JC
  * terminal_retrieve
  *	DESCRIPTION:
  *		Puts the saved buffer from the previous output into the buf.
- *		Used by the keyboard.
+ *		Used by the keyboard, reads the line of the terminal the caller runs in.
  */
 int32_t terminal_retrieve(uint8_t* buf, int32_t nbytes){
 	int32_t i = 0; // goes through the whole save buffer
 	int32_t cmd_cnt = 0; // starts filling buf from the beginning
 
-	while(save_buff[curr_terminal][i] == ' ' && i < nbytes && i < TERM_BUFF_SIZE)
+	while(save_buff[sched_terminal][i] == ' ' && i < nbytes && i < TERM_BUFF_SIZE)
 		i++; // get to the real content, strip the beginning spaces
 
 	for(; cmd_cnt < nbytes && i < TERM_BUFF_SIZE; i++){
-		buf[cmd_cnt] = save_buff[curr_terminal][i];
-		if (save_buff[curr_terminal][i] == '\0') break; // I need this to not break the shell
+		buf[cmd_cnt] = save_buff[sched_terminal][i];
+		if (save_buff[sched_terminal][i] == '\0') break; // I need this to not break the shell
 		cmd_cnt++; // off by one, should count when it's not a space
 	}
 
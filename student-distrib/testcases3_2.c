@@ -4,6 +4,7 @@
  */
 
 #include "testcases3_2.h"
+#include "sched.h"
 
 /* JC
  * test_file_data
@@ -89,3 +90,248 @@ void print_freq(uint32_t rate)
 	else
 		printf("couldn't open\n");
 }
+
+/* JC
+ * test_dentry_lookup
+ *		DESCRIPTION:
+ *			Looks up every file name, plus one that doesn't exist, with the
+ *			hashed read_dentry_by_name and the old linear scan. Checks they
+ *			agree and prints the average cycles per lookup of each.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *
+ */
+void test_dentry_lookup()
+{
+	uint32_t i, round;
+	uint32_t num = get_num_entries();
+	uint64_t start;
+	uint32_t hash_cycles, scan_cycles; // a few hundred million at most
+	dentry_t hashed, scanned;
+	uint8_t name[MAX_NAME_CHARACTERS+1];
+	uint8_t* missing = (uint8_t*)"not_a_file";
+
+	// check both lookups find the same dentry
+	for(i = 0; i < num; i++)
+	{
+		strncpy((int8_t*)name, get_entry_name(i), MAX_NAME_CHARACTERS);
+		name[MAX_NAME_CHARACTERS] = '\0';
+		if(read_dentry_by_name(name, &hashed) != scan_dentry_by_name(name, &scanned)
+				|| hashed.inode_idx != scanned.inode_idx)
+		{
+			printf("lookup mismatch on entry %d\n", i);
+			return;
+		}
+	}
+	if(read_dentry_by_name(missing, &hashed) != -1)
+	{
+		printf("found a file that doesn't exist\n");
+		return;
+	}
+
+	start = rdtsc();
+	for(round = 0; round < LOOKUP_ROUNDS; round++)
+		for(i = 0; i <= num; i++)
+			read_dentry_by_name((i == num) ? missing : (uint8_t*)get_entry_name(i), &hashed);
+	hash_cycles = (uint32_t)(rdtsc() - start);
+
+	start = rdtsc();
+	for(round = 0; round < LOOKUP_ROUNDS; round++)
+		for(i = 0; i <= num; i++)
+			scan_dentry_by_name((i == num) ? missing : (uint8_t*)get_entry_name(i), &scanned);
+	scan_cycles = (uint32_t)(rdtsc() - start);
+
+	printf("hashed lookup: %d cycles\n", hash_cycles / (LOOKUP_ROUNDS*(num+1)));
+	printf("linear lookup: %d cycles\n", scan_cycles / (LOOKUP_ROUNDS*(num+1)));
+}
+
+/* JC
+ * test_read_throughput
+ *		DESCRIPTION:
+ *			Reads every file in one read_data call, checks the bytes against the
+ *			data blocks one at a time, then prints the cycles read_data takes
+ *			per KB over all the files.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *
+ */
+void test_read_throughput()
+{
+	static uint8_t buffer[READ_BUF_SIZE]; // too big for the kernel stack
+	uint32_t i, j, round;
+	uint32_t num = get_num_entries();
+	uint32_t total_bytes = 0;
+	uint64_t start;
+	uint32_t cycles;
+	int32_t size;
+	dentry_t file;
+
+	for(i = 0; i < num; i++)
+	{
+		read_dentry_by_index(i, &file);
+		size = read_data(file.inode_idx, 0, buffer, READ_BUF_SIZE);
+		if(size <= 0)
+			continue; // directory or device
+		for(j = 0; j < size; j++)
+		{
+			if(buffer[j] != (uint8_t)((data_blocks[(inodes[file.inode_idx]).datablock_idx[j/MAX_CHARS_IN_DATA]]).data)[j%MAX_CHARS_IN_DATA])
+			{
+				printf("bad byte %d in entry %d\n", j, i);
+				return;
+			}
+		}
+		total_bytes += size;
+	}
+
+	start = rdtsc();
+	for(round = 0; round < READ_ROUNDS; round++)
+	{
+		for(i = 0; i < num; i++)
+		{
+			read_dentry_by_index(i, &file);
+			read_data(file.inode_idx, 0, buffer, READ_BUF_SIZE);
+		}
+	}
+	cycles = (uint32_t)(rdtsc() - start);
+
+	printf("read %d bytes %d times\n", total_bytes, READ_ROUNDS);
+	printf("read_data: %d cycles per KB\n", cycles / ((total_bytes*READ_ROUNDS) >> KB_SHIFT));
+}
+
+/* JC
+ * switch_cycles - helper
+ *		DESCRIPTION:
+ *			Reloads the page directory like a process switch does, then touches
+ *			the kernel pages every switch ends up touching: kernel code and stack
+ *			(the 4MB page), the file system module and every terminal's screen.
+ *		INPUT: pid - the running process, its pages get mapped again
+ *		RETURN VALUE: average cycles per switch
+ *
+ */
+static uint32_t switch_cycles(uint32_t pid)
+{
+	uint32_t round, t;
+	volatile uint32_t sink = 0;
+	uint64_t start = rdtsc();
+
+	for(round = 0; round < SWITCH_ROUNDS; round++)
+	{
+		add_process(pid);
+		sink += *(volatile uint32_t*)boot_block;
+		for(t = 0; t < MAX_TERMINAL; t++)
+			sink += *(volatile uint32_t*)(BACKUP_VID1 + t*(BACKUP_VID2 - BACKUP_VID1));
+	}
+	return (uint32_t)(rdtsc() - start) / SWITCH_ROUNDS;
+}
+
+/* JC
+ * test_tlb_switch
+ *		DESCRIPTION:
+ *			Times page directory reloads with the kernel pages global, then with
+ *			global pages off so the kernel has to refill its TLB entries every time.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *
+ */
+void test_tlb_switch()
+{
+	int32_t pid = current_process[sched_terminal]; // the process the keyboard interrupted
+	uint32_t global_cycles, plain_cycles;
+
+	if(pid < 0)
+	{
+		printf("no process to switch to\n");
+		return;
+	}
+
+	global_cycles = switch_cycles(pid);
+	set_global_pages(0);
+	plain_cycles = switch_cycles(pid);
+	set_global_pages(1);
+
+	printf("switch with global kernel pages: %d cycles\n", global_cycles);
+	printf("switch without global pages:     %d cycles\n", plain_cycles);
+}
+
+/* JC
+ * test_exec_launch
+ *		DESCRIPTION:
+ *			Times the work execute does before a program can start: finding it
+ *			and checking its ELF header. Only names that turn out to be
+ *			programs are timed, and only one per cache entry so the warm rounds
+ *			never miss. Once with the cache emptied before every lookup, as
+ *			the first launch of a command sees it, then with the cache warm.
+ *			The flushes aren't timed. Prints the average cycles per launch of each.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *
+ */
+void test_exec_launch()
+{
+	static uint8_t names[EXEC_CACHE_SIZE][MAX_NAME_CHARACTERS+1]; // too big for the stack
+	uint32_t i, round;
+	uint32_t num = get_num_entries();
+	uint32_t programs = 0;
+	uint32_t slots_used = 0; // a bit per cache entry, the cache is indexed by inode
+	uint64_t start;
+	uint32_t cold_cycles = 0, warm_cycles;
+	exec_info_t info;
+
+	for(i = 0; i < num && programs < EXEC_CACHE_SIZE; i++)
+	{
+		strncpy((int8_t*)names[programs], get_entry_name(i), MAX_NAME_CHARACTERS);
+		names[programs][MAX_NAME_CHARACTERS] = '\0';
+		if(exec_lookup(names[programs], &info) == 0
+				&& !(slots_used & (1 << (info.inode % EXEC_CACHE_SIZE))))
+		{
+			slots_used |= 1 << (info.inode % EXEC_CACHE_SIZE);
+			programs++;
+		}
+	}
+	if(programs == 0)
+	{
+		printf("no programs to launch\n");
+		return;
+	}
+
+	for(round = 0; round < LAUNCH_ROUNDS; round++)
+	{
+		for(i = 0; i < programs; i++)
+		{
+			exec_cache_flush();
+			start = rdtsc();
+			exec_lookup(names[i], &info);
+			cold_cycles += (uint32_t)(rdtsc() - start);
+		}
+	}
+
+	start = rdtsc();
+	for(round = 0; round < LAUNCH_ROUNDS; round++)
+		for(i = 0; i < programs; i++)
+			exec_lookup(names[i], &info);
+	warm_cycles = (uint32_t)(rdtsc() - start);
+
+	printf("%d programs timed\n", programs);
+	printf("cold launch: %d cycles\n", cold_cycles / (LAUNCH_ROUNDS*programs));
+	printf("warm launch: %d cycles\n", warm_cycles / (LAUNCH_ROUNDS*programs));
+}
+
+/* JC
+ * test_next_quantum
+ *		DESCRIPTION:
+ *			Gives the scheduler the next time slice length, so how a workload
+ *			behaves with short and long slices can be compared without
+ *			rebuilding. Starts from DEFAULT_QUANTUM.
+ *		INPUT: none
+ *		RETURN VALUE: none
+ *
+ */
+void test_next_quantum()
+{
+	static const uint32_t quanta[NUM_QUANTA] = {DEFAULT_QUANTUM, 10, MAX_QUANTUM, 1};
+	static uint32_t next = 1;
+
+	set_quantum(quanta[next]);
+	printf("time slice: %d ticks, %d ms\n", quanta[next], quanta[next] * 1000 / PIT_HZ);
+	next = (next + 1) % NUM_QUANTA;
+}
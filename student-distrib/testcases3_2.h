@@ -12,14 +12,28 @@
 #include "rtc.h"
 #include "terminal.h"
 #include "keyboard.h"
+#include "paging.h"
+#include "syscall.h"
 
 #define SCREEN_CHAR 80
 #define HIGHEST_RATES 10
 #define HIGHEST_FREQ 32768
+#define LOOKUP_ROUNDS 1000 // times every name is looked up in the lookup test
+#define READ_ROUNDS 100 // times every file is read in the read test
+#define READ_BUF_SIZE 40000 // bigger than the biggest file in filesys_img
+#define KB_SHIFT 10
+#define SWITCH_ROUNDS 10000 // page directory reloads in the tlb test
+#define LAUNCH_ROUNDS 1000 // times every program is looked up in the launch test
+#define NUM_QUANTA 4 // time slices ctrl+8 goes through
 
 void test_file_data(int index);
 void collective_test32();
 void print_file_text(int8_t* name, int8_t* buffer, int32_t nbytes);
 void print_freq();
+void test_dentry_lookup();
+void test_read_throughput();
+void test_tlb_switch();
+void test_exec_launch();
+void test_next_quantum();
 
 #endif /* _TESTCASES32_H */
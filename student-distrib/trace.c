@@ -0,0 +1,95 @@
+/*
+ * trace.c - The kernel's trace ring buffer.
+ *
+ *		System calls, interrupts (the RTC and PIT only with TRACE_TICKS),
+ *		process and terminal switches and page faults leave a fixed size
+ *		event with a time stamp counter reading in a ring, and the ktrace
+ *		system call moves them out to a program. Writing
+ *		an event takes no lock: xadd hands out the slot, so an interrupt that
+ *		comes in the middle of an event takes the next one. A slot's type is
+ *		written last, the reader leaves a slot that is still TRACE_NONE for the
+ *		next time. When the reader falls a whole ring behind, the oldest events
+ *		are overwritten and it gets a TRACE_LOST event saying how many.
+ *		Without KERNEL_TRACE the trace points compile to nothing.
+ */
+
+#include "trace.h"
+#include "terminal.h"
+
+static trace_event_t ring[TRACE_SIZE];
+static volatile uint32_t head;	// slots handed out, only ever counts up
+static uint32_t tail;			// slots read
+static uint32_t lost;			// overwritten events not reported yet
+
+/*
+ * trace_event
+ *		DESCRIPTION: Records an event in the next slot of the ring.
+ *		INPUT: type - one of the TRACE_ types
+ *				 arg - what the type says
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: overwrites the oldest event once the ring is full
+ */
+void trace_event(uint32_t type, uint32_t arg)
+{
+	uint32_t slot = 1;
+	trace_event_t* event;
+
+	asm volatile("xaddl %0, %1" : "+r"(slot), "+m"(head) : : "memory");
+	event = &ring[slot % TRACE_SIZE];
+
+	event->type = TRACE_NONE;
+	asm volatile("" : : : "memory"); // TRACE_NONE goes out before the rest
+	event->tsc = rdtsc();
+	event->pid = current_process[sched_terminal];
+	event->arg = arg;
+	asm volatile("" : : : "memory");
+	event->type = type;
+}
+
+/*
+ * trace_drain
+ *		DESCRIPTION:
+ *			Copies the events that weren't read yet, oldest first, as many as
+ *			fit. The copied slots are marked TRACE_NONE for the next lap.
+ *		INPUT: buf - where the events go
+ *				 nbytes - size of buf
+ *		RETURN VALUE: number of bytes filled, 0 if there was nothing new
+ */
+int32_t trace_drain(trace_event_t* buf, int32_t nbytes)
+{
+	uint32_t flags;
+	int32_t filled = 0;
+	trace_event_t* event;
+	cli_and_save(flags);
+
+	if(head - tail > TRACE_SIZE)
+	{	// the writers went all the way around
+		lost += head - tail - TRACE_SIZE;
+		tail = head - TRACE_SIZE;
+	}
+
+	if(lost != 0 && filled + (int32_t)sizeof(trace_event_t) <= nbytes)
+	{
+		buf->tsc = ring[tail % TRACE_SIZE].tsc; // goes right before the oldest event left
+		buf->type = TRACE_LOST;
+		buf->pid = current_process[sched_terminal];
+		buf->arg = lost;
+		buf++;
+		filled += sizeof(trace_event_t);
+		lost = 0;
+	}
+
+	while(tail != head && filled + (int32_t)sizeof(trace_event_t) <= nbytes)
+	{
+		event = &ring[tail % TRACE_SIZE];
+		if(event->type == TRACE_NONE)
+			break; // an interrupted writer still has it
+		*buf++ = *event;
+		event->type = TRACE_NONE;
+		tail++;
+		filled += sizeof(trace_event_t);
+	}
+
+	restore_flags(flags);
+	return filled;
+}
@@ -0,0 +1,51 @@
+/*
+ * trace.h - Declarations for the kernel's trace ring buffer.
+ *
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#define KERNEL_TRACE // comment out to compile every trace point out
+// #define TRACE_TICKS // the RTC and PIT irqs too, at 1024Hz they fill the ring in a second
+
+/* event types, TRACE_NONE marks a slot that is being written */
+#define TRACE_NONE          0
+#define TRACE_SYSCALL_ENTER 1  // arg - system call number
+#define TRACE_SYSCALL_EXIT  2  // arg - system call number
+#define TRACE_IRQ_ENTER     3  // arg - irq
+#define TRACE_IRQ_EXIT      4  // arg - irq
+#define TRACE_SWITCH        5  // arg - pid switched to
+#define TRACE_PAGE_FAULT    6  // arg - faulting address
+#define TRACE_TERMINAL      7  // arg - terminal switched to
+#define TRACE_LOST          8  // arg - events overwritten before they were read
+
+#define TRACE_SIZE 1024 // events in the ring, a power of 2
+
+#ifndef ASM
+
+#include "lib.h"
+
+/* one event, the same layout as ece391_trace_t on the user side */
+typedef struct trace_event_t {
+	uint64_t tsc;		// time stamp counter when it happened
+	uint16_t type;
+	int16_t pid;		// the running process, -1 while booting
+	uint32_t arg;
+} trace_event_t;
+
+#ifdef KERNEL_TRACE
+#define TRACE(type, arg) trace_event(type, (uint32_t)(arg))
+#else
+#define TRACE(type, arg) do {} while(0)
+#endif
+
+/* records an event, safe to call from anywhere */
+void trace_event(uint32_t type, uint32_t arg);
+
+/* moves the events not read yet into buf, returns the bytes filled */
+int32_t trace_drain(trace_event_t* buf, int32_t nbytes);
+
+#endif /* ASM */
+
+#endif /* _TRACE_H */
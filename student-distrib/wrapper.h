@@ -4,8 +4,11 @@
 extern void keyboard_handler_wrapper(void);
 extern void rtc_handler_wrapper(void);
 extern void pit_handler_wrapper(void);
+extern void page_fault_wrapper(void);
 extern void syscall_handler_wrapper(void);
+extern void sysenter_handler(void);
 extern void user_context_switch(unsigned int entry_point);
+extern void context_switch(unsigned int* save_esp, unsigned int new_esp);
 extern void sys_ret(void);
 extern void sys_ret_halt(void);
 
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "ece391support.h"
@@ -176,6 +177,62 @@ ece391_vidmap (uint8_t** screen_start)
     return 0;
 }
 
+int32_t
+ece391_mmap (int32_t fd, uint8_t** start)
+{
+    off_t size;
+    void* file_image;
+
+    if (NULL != dir && dir_fd == fd)
+        return -1;
+    if (-1 == (size = lseek (fd, 0, SEEK_END)) || -1 == lseek (fd, 0, SEEK_SET))
+        return -1;
+    if (0 == size) {
+        *start = NULL;
+        return 0;
+    }
+
+    if ((file_image = mmap ((void*)0, size, PROT_READ, MAP_PRIVATE,
+                    fd, 0)) == MAP_FAILED)
+        return -1;
+
+    *start = (uint8_t*)file_image;
+    return size;
+}
+
+int32_t
+ece391_munmap (uint8_t* start, int32_t length)
+{
+    return munmap (start, length);
+}
+
+int32_t
+ece391_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes)
+{
+    struct dirent* de;
+    struct stat st;
+    int32_t filled, len;
+
+    if (NULL == dir || dir_fd != fd)
+        return -1;
+    for (filled = 0; filled < nbytes / (int32_t)sizeof (ece391_dirent_t);
+	 filled++) {
+        if (NULL == (de = readdir (dir)))
+	    break;
+	for (len = 0; len < 32; len++) {
+	    buf[filled].name[len] = de->d_name[len];
+	    if ('\0' == de->d_name[len])
+	        break;
+	}
+	while (len < 32)
+	    buf[filled].name[len++] = '\0';
+	buf[filled].inode = de->d_ino;
+	buf[filled].type = (DT_DIR == de->d_type) ? 1 : 2;
+	buf[filled].size = (0 == stat (de->d_name, &st)) ? st.st_size : 0;
+    }
+    return filled * sizeof (ece391_dirent_t);
+}
+
 int32_t
 ece391_read (int32_t fd, void* buf, int32_t nbytes)
 {
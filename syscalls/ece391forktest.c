@@ -0,0 +1,51 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 16
+#define PAGES 4
+#define PAGE_SIZE 4096
+
+/* one page per entry, so every write lands on a different shared page */
+static uint32_t pages[PAGES][PAGE_SIZE / sizeof (uint32_t)];
+
+/* writes a message and a number */
+static void
+report (const char* msg, uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)msg);
+    ece391_fdputs (1, ece391_itoa (value, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    int32_t pid, i;
+    uint32_t sum = 0;
+
+    for (i = 0; i < PAGES; i++)
+        pages[i][0] = i + 1;
+
+    if (-1 == (pid = ece391_fork ())) {
+        ece391_fdputs (1, (uint8_t*)"fork failed\n");
+        return 3;
+    }
+
+    if (0 == pid) {
+        /* the child's writes get private copies, the parent never sees them */
+        for (i = 0; i < PAGES; i++)
+            pages[i][0] = 0;
+        ece391_fdputs (1, (uint8_t*)"child: cleared its pages\n");
+        return 0;
+    }
+
+    report ("parent: forked pid ", pid);
+    for (i = 0; i < PAGES; i++)
+        sum += pages[i][0];
+    report ("parent: sum of its pages (10 expected) ", sum);
+
+    return 0;
+}
@@ -5,18 +5,44 @@
 
 #define BUFSIZE 1024
 #define SBUFSIZE 33
+#define NUM_DENTS 16
 
+/* searches a file mapped with mmap, lines don't have to be copied */
 int32_t
-do_one_file (const char* s, const char* fname) 
+do_one_mapping (const char* s, const char* fname, const uint8_t* data,
+		int32_t size)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
-    uint8_t data[BUFSIZE+1];
+    int32_t line_start, line_end, check, s_len;
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
+    for (line_start = 0; line_start < size; line_start = line_end + 1) {
+	line_end = line_start;
+	while (line_end < size && '\n' != data[line_end])
+	    line_end++;
+	/* search the line */
+	for (check = line_start; check + s_len <= line_end; check++) {
+	    if (s[0] == data[check] && 
+		0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
+		ece391_fdputs (1, (uint8_t*)fname);
+		ece391_fdputs (1, (uint8_t*)":");
+		ece391_write (1, data + line_start, line_end - line_start);
+		ece391_fdputs (1, (uint8_t*)"\n");
+		break;
+	    }
+	}
     }
+    return 0;
+}
+
+/* searches a file that can't be mapped by reading it a buffer at a time,
+   lines aren't prefixed with a name if fname is 0 */
+int32_t
+do_one_stream (const char* s, const char* fname, int32_t fd)
+{
+    int32_t cnt, last, line_start, line_end, check, s_len;
+    uint8_t data[BUFSIZE+1];
+
+    s_len = ece391_strlen ((uint8_t*)s);
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -30,8 +56,10 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
-		/* copy from line_start to last down to 0 and fix last */
+	    if ('\n' != data[line_end] && 0 != cnt &&
+		(line_start != 0 || last < BUFSIZE)) {
+		/* copy from line_start to last down to 0 and fix last,
+		   a pipe can hand a line over in pieces */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
 		last -= line_start;
@@ -42,8 +70,10 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
+		    if (0 != fname) {
+			ece391_fdputs (1, (uint8_t*)fname);
+			ece391_fdputs (1, (uint8_t*)":");
+		    }
 		    ece391_fdputs (1, data + line_start);
 		    ece391_fdputs (1, (uint8_t*)"\n");
 		    break;
@@ -58,6 +88,27 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd, cnt;
+    uint8_t* file;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    /* regular files get mapped, devices still go through read */
+    if (-1 != (cnt = ece391_mmap (fd, &file))) {
+	do_one_mapping (s, fname, file, cnt);
+	if (0 != cnt)
+	    ece391_munmap (file, cnt);
+    } else if (0 != do_one_stream (s, fname, fd)) {
+        return -1;
+    }
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -67,30 +118,39 @@ do_one_file (const char* s, const char* fname)
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i, len;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    ece391_dirent_t dents[NUM_DENTS];
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
         return 3;
     }
 
+    /* at the end of a pipe, search what comes in instead of the files */
+    if (0 == ece391_isatty (0))
+        return (0 != do_one_stream ((char*)search, 0, 0)) ? 3 : 0;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, dents, sizeof (dents)))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
-	buf[cnt] = '\0';
-	if (0 != do_one_file ((char*)search, (char*)buf))
-	    return 3;
+	for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	    if ('.' == dents[i].name[0]) /* a directory... */
+		continue;
+	    for (len = 0; len < SBUFSIZE - 1 && '\0' != dents[i].name[len]; len++)
+		buf[len] = dents[i].name[len];
+	    buf[len] = '\0';
+	    if (0 != do_one_file ((char*)search, (char*)buf))
+		return 3;
+	}
     }
 
     return 0;
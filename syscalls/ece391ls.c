@@ -4,10 +4,12 @@
 #include "ece391syscall.h"
 
 #define SBUFSIZE 33
+#define NUM_DENTS 16
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i, len;
+    ece391_dirent_t dents[NUM_DENTS];
     uint8_t buf[SBUFSIZE];
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
@@ -15,14 +17,18 @@ int main ()
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, dents, sizeof (dents)))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	        for (len = 0; len < SBUFSIZE - 1 && '\0' != dents[i].name[len]; len++)
+	            buf[len] = dents[i].name[len];
+	        buf[len] = '\n';
+	        if (-1 == ece391_write (1, buf, len + 1))
+	            return 3;
+	    }
     }
 
     return 0;
@@ -5,10 +5,48 @@
 
 #define BUFSIZE 1024
 
+/*
+ * runs left | right: left in a forked child with its output going into a
+ * pipe, right in the shell's place reading from it
+ */
+static int32_t
+run_pipeline (uint8_t* left, uint8_t* right)
+{
+    int32_t fds[2];
+    int32_t pid, rval;
+
+    if (-1 == ece391_pipe (fds))
+        return -1;
+
+    if (-1 == (pid = ece391_fork ())) {
+        ece391_close (fds[0]);
+        ece391_close (fds[1]);
+        return -1;
+    }
+
+    if (0 == pid) {
+        ece391_dup2 (fds[1], 1);
+        ece391_close (fds[0]);
+        ece391_close (fds[1]);
+        ece391_halt (ece391_execute (left)); /* right sees the end of the pipe */
+    }
+
+    /* keep the keyboard where the write end was, right has to see the pipe close */
+    ece391_dup2 (0, fds[1]);
+    ece391_dup2 (fds[0], 0);
+    ece391_close (fds[0]);
+    rval = ece391_execute (right);
+    ece391_dup2 (fds[1], 0);
+    ece391_close (fds[1]);
+    return rval;
+}
+
 int main ()
 {
     int32_t cnt, rval;
     uint8_t buf[BUFSIZE];
+    uint8_t* bar;
+    uint8_t* end;
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
@@ -24,7 +62,14 @@ int main ()
     	    return 0;
     	if ('\0' == buf[0]) // if there's nothing
     	    continue;
-    	rval = ece391_execute (buf);
+    	for (bar = buf; '\0' != *bar && '|' != *bar; bar++);
+    	if ('|' == *bar) {
+    	    for (end = bar; end > buf && ' ' == end[-1]; end--);
+    	    *end = '\0';
+    	    for (bar++; ' ' == *bar; bar++);
+    	    rval = run_pipeline (buf, bar);
+    	} else
+    	    rval = ece391_execute (buf);
     	if (-1 == rval)
     	    ece391_fdputs (1, (uint8_t*)"no such command\n");
     	else if (256 == rval)
@@ -0,0 +1,162 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TOTAL (1024 * 1024) /* bytes each test moves */
+#define CHUNK 4096
+#define SEG_SIZE (64 * 1024)
+#define RING_SIZE (SEG_SIZE - CHUNK) /* the first page holds the counters */
+#define KB_SHIFT 10
+#define BUFSIZE 16
+
+/* a ring of chunks in the shared segment */
+typedef struct ring_t {
+    volatile int32_t head; /* bytes the producer wrote */
+    volatile int32_t tail; /* bytes the consumer took */
+    volatile int32_t producer_waits; /* the side waiting in futex_wait wants a wake up */
+    volatile int32_t consumer_waits;
+    uint8_t pad[CHUNK - 4 * sizeof (int32_t)];
+    uint8_t data[RING_SIZE];
+} ring_t;
+
+static uint8_t chunk[CHUNK];
+static uint8_t sink[CHUNK];
+
+/* cycles since reset */
+static uint64_t
+rdtsc ()
+{
+    uint64_t val;
+    asm volatile ("rdtsc" : "=A" (val));
+    return val;
+}
+
+/* copies n bytes, a multiple of 4 */
+static void
+copy (uint8_t* dst, const uint8_t* src, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n / 4; i++)
+        ((uint32_t*)dst)[i] = ((const uint32_t*)src)[i];
+    asm volatile ("" : : : "memory"); /* the data is there before the counter moves */
+}
+
+/* sleeps until *word moves away from seen, the other side wakes us when it moves it */
+static void
+wait_for (volatile int32_t* word, int32_t seen, volatile int32_t* waits)
+{
+    *waits = 1;
+    ece391_futex_wait (word, seen); /* returns at once if it moved already */
+    *waits = 0;
+}
+
+/* moves *word along by CHUNK, waking the other side if it sleeps on it */
+static void
+advance (volatile int32_t* word, volatile int32_t* waits)
+{
+    *word += CHUNK;
+    if (*waits)
+        ece391_futex_wake (word, 1);
+}
+
+/* writes one result line */
+static void
+report (const char* name, uint32_t cycles)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, ece391_itoa (cycles / (TOTAL >> KB_SHIFT), buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per KB\n");
+}
+
+/* a forked child writes TOTAL bytes into a pipe, we read them */
+static int32_t
+pipe_test (uint32_t* cycles)
+{
+    int32_t fds[2], pid, cnt;
+    uint32_t moved = 0;
+    uint64_t start = rdtsc ();
+
+    if (-1 == ece391_pipe (fds))
+        return -1;
+    if (-1 == (pid = ece391_fork ()))
+        return -1;
+
+    if (0 == pid) {
+        ece391_close (fds[0]);
+        for (moved = 0; moved < TOTAL; moved += CHUNK)
+            if (-1 == ece391_write (fds[1], chunk, CHUNK))
+                break;
+        ece391_halt (0);
+    }
+
+    ece391_close (fds[1]);
+    while (0 < (cnt = ece391_read (fds[0], sink, CHUNK)))
+        moved += cnt;
+    ece391_close (fds[0]);
+
+    *cycles = (uint32_t)(rdtsc () - start);
+    return (TOTAL == moved) ? 0 : -1;
+}
+
+/* a forked child puts TOTAL bytes into a ring in shared memory, we take them */
+static int32_t
+shm_test (uint32_t* cycles)
+{
+    ring_t* ring;
+    int32_t pid, size, seen;
+    uint64_t start = rdtsc ();
+
+    if (-1 == (size = ece391_shmmap ((uint8_t*)"shmbench", sizeof (ring_t), (uint8_t**)&ring)))
+        return -1;
+    ring->head = 0; /* an earlier run's child may not be cleaned up yet */
+    ring->tail = 0;
+    ring->producer_waits = 0;
+    ring->consumer_waits = 0;
+    if (-1 == (pid = ece391_fork ()))
+        return -1;
+
+    if (0 == pid) {
+        while (ring->head < TOTAL) {
+            /* read the word before the check, a move in between ends the wait */
+            for (seen = ring->tail; ring->head - seen > RING_SIZE - CHUNK; seen = ring->tail)
+                wait_for (&ring->tail, seen, &ring->producer_waits);
+            copy (ring->data + ring->head % RING_SIZE, chunk, CHUNK);
+            advance (&ring->head, &ring->consumer_waits);
+        }
+        ece391_halt (0);
+    }
+
+    while (ring->tail < TOTAL) {
+        for (seen = ring->head; seen == ring->tail; seen = ring->head)
+            wait_for (&ring->head, seen, &ring->consumer_waits);
+        copy (sink, ring->data + ring->tail % RING_SIZE, CHUNK);
+        advance (&ring->tail, &ring->producer_waits);
+    }
+    ece391_munmap ((uint8_t*)ring, size);
+
+    *cycles = (uint32_t)(rdtsc () - start);
+    return 0;
+}
+
+int main ()
+{
+    uint32_t pipe_cycles, shm_cycles;
+
+    if (0 != pipe_test (&pipe_cycles)) {
+        ece391_fdputs (1, (uint8_t*)"pipe test failed\n");
+        return 3;
+    }
+    if (0 != shm_test (&shm_cycles)) {
+        ece391_fdputs (1, (uint8_t*)"shared memory test failed\n");
+        return 3;
+    }
+
+    report ("pipe:          ", pipe_cycles);
+    report ("shared memory: ", shm_cycles);
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define MAX_CACHES 16
+#define BUFSIZE 16
+#define NAME_WIDTH 16
+#define NUM_WIDTH 9
+
+/* writes s padded with spaces to width */
+static void
+column (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+/* writes a number as a column */
+static void
+number (uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+
+    column (ece391_itoa (value, buf, 10), NUM_WIDTH);
+}
+
+int main ()
+{
+    ece391_kmstat_t stats[MAX_CACHES];
+    int32_t cnt, i;
+
+    if (-1 == (cnt = ece391_kmstat (stats, sizeof (stats)))) {
+        ece391_fdputs (1, (uint8_t*)"kmstat failed\n");
+        return 3;
+    }
+
+    column ((uint8_t*)"cache", NAME_WIDTH);
+    column ((uint8_t*)"size", NUM_WIDTH);
+    column ((uint8_t*)"in use", NUM_WIDTH);
+    column ((uint8_t*)"total", NUM_WIDTH);
+    column ((uint8_t*)"slabs", NUM_WIDTH);
+    column ((uint8_t*)"allocs", NUM_WIDTH);
+    column ((uint8_t*)"frees", NUM_WIDTH);
+    ece391_fdputs (1, (uint8_t*)"failed\n");
+
+    for (i = 0; i < cnt / (int32_t)sizeof (ece391_kmstat_t); i++) {
+        column (stats[i].name, NAME_WIDTH);
+        number (stats[i].size);
+        number (stats[i].in_use);
+        number (stats[i].total);
+        number (stats[i].slabs);
+        number (stats[i].allocs);
+        number (stats[i].frees);
+        number (stats[i].failures);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -102,3 +102,76 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+/* Atomically sets *addr to new if it holds old, returns what it held */
+static int32_t cmpxchg(volatile int32_t* addr, int32_t old, int32_t new)
+{
+    int32_t prev;
+
+    asm volatile ("lock cmpxchgl %2, %1"
+                  : "=a" (prev), "+m" (*addr)
+                  : "r" (new), "0" (old)
+                  : "memory");
+    return prev;
+}
+
+/* Atomically sets *addr to val, returns what it held */
+static int32_t xchg(volatile int32_t* addr, int32_t val)
+{
+    asm volatile ("xchgl %0, %1"
+                  : "+r" (val), "+m" (*addr)
+                  :
+                  : "memory");
+    return val;
+}
+
+/* Takes the lock, only enters the kernel if someone else holds it */
+void ece391_mutex_lock(ece391_mutex_t* m)
+{
+    int32_t c;
+
+    if (0 == (c = cmpxchg(&m->state, 0, 1)))
+        return;
+
+    /* say there is a waiter, whoever unlocks has to wake us */
+    if (2 != c)
+        c = xchg(&m->state, 2);
+    while (0 != c) {
+        ece391_futex_wait(&m->state, 2);
+        c = xchg(&m->state, 2);
+    }
+}
+
+/* Gives the lock back, only enters the kernel if someone may be waiting */
+void ece391_mutex_unlock(ece391_mutex_t* m)
+{
+    if (2 == xchg(&m->state, 0))
+        ece391_futex_wake(&m->state, 1);
+}
+
+/* Unlocks m, sleeps until the condition is signalled and locks m again */
+void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m)
+{
+    int32_t seq = c->seq;
+
+    ece391_mutex_unlock(m);
+    ece391_futex_wait(&c->seq, seq);
+
+    /* others may be woken with us, take the lock as a waiter */
+    while (0 != xchg(&m->state, 2))
+        ece391_futex_wait(&m->state, 2);
+}
+
+/* Wakes one process waiting on the condition */
+void ece391_cond_signal(ece391_cond_t* c)
+{
+    asm volatile ("lock incl %0" : "+m" (c->seq) : : "memory");
+    ece391_futex_wake(&c->seq, 1);
+}
+
+/* Wakes every process waiting on the condition */
+void ece391_cond_broadcast(ece391_cond_t* c)
+{
+    asm volatile ("lock incl %0" : "+m" (c->seq) : : "memory");
+    ece391_futex_wake(&c->seq, 0x7FFFFFFF);
+}
@@ -9,5 +9,22 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* 0 - unlocked, 1 - locked, 2 - locked and someone may be waiting */
+typedef struct ece391_mutex_t {
+    volatile int32_t state;
+} ece391_mutex_t;
+
+/* counts signals, a waiter sleeps until it changes */
+typedef struct ece391_cond_t {
+    volatile int32_t seq;
+} ece391_cond_t;
+
+/* locks and conditions in memory shared with shmmap, zeroed is unlocked */
+extern void ece391_mutex_lock(ece391_mutex_t* m);
+extern void ece391_mutex_unlock(ece391_mutex_t* m);
+extern void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m);
+extern void ece391_cond_signal(ece391_cond_t* c);
+extern void ece391_cond_broadcast(ece391_cond_t* c);
+
 #endif /* ECE391SUPPORT_H */
 
@@ -0,0 +1,56 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 10000
+#define BUFSIZE 16
+
+/* cycles since reset */
+static uint64_t
+rdtsc ()
+{
+    uint64_t val;
+    asm volatile ("rdtsc" : "=A" (val));
+    return val;
+}
+
+/* writes one result line */
+static void
+report (const char* name, uint32_t cycles)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, ece391_itoa (cycles / ROUNDS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per call\n");
+}
+
+int main ()
+{
+    int32_t i;
+    uint64_t start;
+    uint32_t int_cycles, fast_cycles;
+    uint8_t buf[1];
+
+    /* a write of 0 bytes to the terminal does almost nothing in the kernel */
+    start = rdtsc ();
+    for (i = 0; i < ROUNDS; i++)
+        ece391_int_write (1, buf, 0);
+    int_cycles = (uint32_t)(rdtsc () - start);
+    report ("int $0x80: ", int_cycles);
+
+    /* the kernel only sets SYSENTER up if the processor has it */
+    if (!ece391_have_sysenter ()) {
+        ece391_fdputs (1, (uint8_t*)"sysenter:  not supported\n");
+        return 0;
+    }
+
+    start = rdtsc ();
+    for (i = 0; i < ROUNDS; i++)
+        ece391_fast_write (1, buf, 0);
+    fast_cycles = (uint32_t)(rdtsc () - start);
+    report ("sysenter:  ", fast_cycles);
+
+    return 0;
+}
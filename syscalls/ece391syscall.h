@@ -5,6 +5,69 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* 
+ * One directory entry filled in by getdents.  The name is padded with
+ * zeroes, but is not terminated if it is 32 characters long.
+ */
+typedef struct ece391_dirent_t {
+	uint8_t  name[32];
+	uint32_t type;
+	uint32_t inode;
+	uint32_t size;
+} ece391_dirent_t;
+
+/*
+ * Statistics of one kernel object cache, filled in by kmstat.  The
+ * name is always terminated.
+ */
+typedef struct ece391_kmstat_t {
+	uint8_t  name[16];
+	uint32_t size;
+	uint32_t in_use;
+	uint32_t total;
+	uint32_t slabs;
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t failures;
+} ece391_kmstat_t;
+
+/*
+ * One kernel trace event, filled in by ktrace.  tsc is the time stamp
+ * counter when it happened, what arg holds depends on the type.
+ */
+typedef struct ece391_trace_t {
+	uint64_t tsc;
+	uint16_t type;
+	int16_t  pid;
+	uint32_t arg;
+} ece391_trace_t;
+
+/*
+ * Counts and latencies of one system call, filled in by sysstat.  Bucket
+ * b of latency counts the calls that took 2^b to 2^(b+1) - 1 cycles.
+ */
+#define ECE391_LATENCY_BUCKETS 32
+
+typedef struct ece391_sysstat_t {
+	uint32_t calls;			/* by every process since boot */
+	uint32_t process_calls;	/* by the process asked about */
+	uint64_t cycles;
+	uint32_t latency[ECE391_LATENCY_BUCKETS];
+} ece391_sysstat_t;
+
+enum trace_types {
+	TRACE_NONE = 0,
+	TRACE_SYSCALL_ENTER,	/* arg is the system call number */
+	TRACE_SYSCALL_EXIT,
+	TRACE_IRQ_ENTER,		/* arg is the irq */
+	TRACE_IRQ_EXIT,
+	TRACE_SWITCH,			/* arg is the pid switched to */
+	TRACE_PAGE_FAULT,		/* arg is the faulting address */
+	TRACE_TERMINAL,			/* arg is the terminal switched to */
+	TRACE_LOST,				/* arg is how many events were overwritten */
+	NUM_TRACE_TYPES
+};
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +84,40 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+/* mmap maps a whole file read only and returns its size */
+extern int32_t ece391_mmap (int32_t fd, uint8_t** start);
+extern int32_t ece391_munmap (uint8_t* start, int32_t length);
+/* getdents fills buf with as many entries as fit, returns bytes filled */
+extern int32_t ece391_getdents (int32_t fd, ece391_dirent_t* buf, int32_t nbytes);
+/* kmstat fills buf with a record per kernel cache, returns bytes filled */
+extern int32_t ece391_kmstat (ece391_kmstat_t* buf, int32_t nbytes);
+/* fork returns the child's pid to the parent and 0 to the child */
+extern int32_t ece391_fork (void);
+/* pipe fills fds with a read end and a write end */
+extern int32_t ece391_pipe (int32_t* fds);
+/* dup2 makes new_fd a copy of old_fd, closing what new_fd was */
+extern int32_t ece391_dup2 (int32_t old_fd, int32_t new_fd);
+/* shmmap maps a named shared memory segment, making it if it doesn't exist,
+   returns its size, munmap unmaps it */
+extern int32_t ece391_shmmap (const uint8_t* name, int32_t nbytes, uint8_t** start);
+/* futex_wait sleeps while *addr is still expected, futex_wake wakes up to n sleepers */
+extern int32_t ece391_futex_wait (volatile int32_t* addr, int32_t expected);
+extern int32_t ece391_futex_wake (volatile int32_t* addr, int32_t n);
+/* ktrace moves the kernel's trace events out, oldest first, returns bytes filled */
+extern int32_t ece391_ktrace (ece391_trace_t* buf, int32_t nbytes);
+/* sysstat fills buf with a record per system call number, pid's own counts
+   go in process_calls, -1 for none, returns bytes filled */
+extern int32_t ece391_sysstat (int32_t pid, ece391_sysstat_t* buf, int32_t nbytes);
+/* isatty returns 1 if fd is the keyboard or the terminal, 0 for anything
+   else that is open, like a pipe or a file put there with dup2 */
+extern int32_t ece391_isatty (int32_t fd);
+/* ece391_read and ece391_write use SYSENTER when ece391_have_sysenter says
+   cpuid 1 reports SEP, int 0x80 otherwise; these pick one themselves */
+extern int32_t ece391_have_sysenter (void);
+extern int32_t ece391_int_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_int_write (int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t ece391_fast_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_fast_write (int32_t fd, const void* buf, int32_t nbytes);
 
 enum signums {
 	DIV_ZERO = 0,
@@ -11,5 +11,18 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_MMAP    11
+#define SYS_MUNMAP  12
+#define SYS_GETDENTS 13
+#define SYS_KMSTAT  14
+#define SYS_FORK    15
+#define SYS_PIPE    16
+#define SYS_DUP2    17
+#define SYS_SHMMAP  18
+#define SYS_FUTEX_WAIT 19
+#define SYS_FUTEX_WAKE 20
+#define SYS_KTRACE  21
+#define SYS_SYSSTAT 22
+#define SYS_ISATTY  23
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,114 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define NUM_SYSCALLS 24
+#define BUFSIZE 32
+#define NAME_WIDTH 12
+#define NUM_WIDTH 9
+
+static const char* call_names[NUM_SYSCALLS] = {
+    "invalid", "halt", "execute", "read", "write", "open", "close",
+    "getargs", "vidmap", "set_handler", "sigreturn", "mmap", "munmap",
+    "getdents", "kmstat", "fork", "pipe", "dup2", "shmmap",
+    "futex_wait", "futex_wake", "ktrace", "sysstat", "isatty"
+};
+
+/* writes s padded with spaces to width */
+static void
+column (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+/* writes a number as a column */
+static void
+number (uint32_t value)
+{
+    uint8_t buf[BUFSIZE];
+
+    column (ece391_itoa (value, buf, 10), NUM_WIDTH);
+}
+
+/* writes the power of 2 a bucket ends at, as <2^n */
+static void
+bound (uint32_t bucket)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_strcpy (buf, (uint8_t*)"<2^");
+    ece391_itoa (bucket + 1, buf + 3, 10);
+    column (buf, NUM_WIDTH);
+}
+
+/* the bucket the calls * part / 100th call falls in */
+static uint32_t
+percentile (const ece391_sysstat_t* s, uint32_t part)
+{
+    uint32_t want = s->calls - (s->calls * (100 - part)) / 100;
+    uint32_t seen = 0, b;
+
+    for (b = 0; b < ECE391_LATENCY_BUCKETS - 1; b++) {
+        seen += s->latency[b];
+        if (seen >= want)
+            break;
+    }
+    return b;
+}
+
+int main ()
+{
+    ece391_sysstat_t stats[NUM_SYSCALLS];
+    uint8_t buf[BUFSIZE];
+    int32_t cnt, i, b, pid = -1;
+
+    /* an optional pid, its own counts get a column */
+    if (0 == ece391_getargs (buf, BUFSIZE) && buf[0] >= '0' && buf[0] <= '9') {
+        for (pid = 0, i = 0; buf[i] >= '0' && buf[i] <= '9'; i++)
+            pid = pid * 10 + buf[i] - '0';
+    }
+
+    if (-1 == (cnt = ece391_sysstat (pid, stats, sizeof (stats)))) {
+        ece391_fdputs (1, (uint8_t*)"sysstat failed\n");
+        return 3;
+    }
+
+    column ((uint8_t*)"call", NAME_WIDTH);
+    column ((uint8_t*)"calls", NUM_WIDTH);
+    if (pid != -1)
+        column ((uint8_t*)"by pid", NUM_WIDTH);
+    column ((uint8_t*)"p50", NUM_WIDTH);
+    ece391_fdputs (1, (uint8_t*)"p99 cycles\n");
+
+    for (i = 0; i < cnt / (int32_t)sizeof (ece391_sysstat_t); i++) {
+        if (stats[i].calls == 0)
+            continue;
+
+        column ((uint8_t*)(i < NUM_SYSCALLS ? call_names[i] : "?"), NAME_WIDTH);
+        number (stats[i].calls);
+        if (pid != -1)
+            number (stats[i].process_calls);
+        bound (percentile (&stats[i], 50));
+        bound (percentile (&stats[i], 99));
+        ece391_fdputs (1, (uint8_t*)"\n");
+
+        /* the histogram, only the buckets that have calls */
+        column ((uint8_t*)"", NAME_WIDTH);
+        for (b = 0; b < ECE391_LATENCY_BUCKETS; b++) {
+            if (stats[i].latency[b] == 0)
+                continue;
+            ece391_fdputs (1, (uint8_t*)" ");
+            ece391_fdputs (1, ece391_itoa (b, buf, 10));
+            ece391_fdputs (1, (uint8_t*)":");
+            ece391_fdputs (1, ece391_itoa (stats[i].latency[b], buf, 10));
+        }
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define MAX_EVENTS 1024
+#define BUFSIZE 16
+#define NAME_WIDTH 16
+#define NUM_WIDTH 12
+
+static ece391_trace_t events[MAX_EVENTS];
+
+static const char* type_names[NUM_TRACE_TYPES] = {
+    "none", "syscall", "sysret", "irq", "irq done",
+    "switch", "page fault", "terminal", "lost"
+};
+
+/* writes s padded with spaces to width */
+static void
+column (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+/* writes a number as a column */
+static void
+number (uint32_t value, int32_t radix)
+{
+    uint8_t buf[BUFSIZE];
+
+    column (ece391_itoa (value, buf, radix), NUM_WIDTH);
+}
+
+int main ()
+{
+    int32_t cnt, i;
+    uint64_t last;
+
+    /* one read, our own writes would keep adding events */
+    if (-1 == (cnt = ece391_ktrace (events, sizeof (events)))) {
+        ece391_fdputs (1, (uint8_t*)"ktrace failed, is KERNEL_TRACE on?\n");
+        return 3;
+    }
+    cnt /= sizeof (ece391_trace_t);
+
+    column ((uint8_t*)"cycles", NUM_WIDTH);
+    column ((uint8_t*)"pid", NUM_WIDTH);
+    column ((uint8_t*)"event", NAME_WIDTH);
+    ece391_fdputs (1, (uint8_t*)"arg\n");
+
+    last = (cnt > 0) ? events[0].tsc : 0;
+    for (i = 0; i < cnt; i++) {
+        /* cycles since the event before, the first one gets 0 */
+        number ((uint32_t)(events[i].tsc - last), 10);
+        last = events[i].tsc;
+        if (events[i].pid < 0)
+            column ((uint8_t*)"-", NUM_WIDTH);
+        else
+            number (events[i].pid, 10);
+        column ((uint8_t*)(events[i].type < NUM_TRACE_TYPES ?
+                type_names[events[i].type] : "unknown"), NAME_WIDTH);
+        if (events[i].type == TRACE_PAGE_FAULT)
+            ece391_fdputs (1, (uint8_t*)"0x");
+        number (events[i].arg, events[i].type == TRACE_PAGE_FAULT ? 16 : 10);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}